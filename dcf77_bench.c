@@ -0,0 +1,265 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * benchmark the decoder with synthetic signals or recorded traces.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "dcf77_trace.h"
+#include "dcf77_signal.h"
+#include "dcf77_decoder.h"
+
+#define BENCH_START 1700000000	// Tue Nov 14 22:13:20 UTC 2023
+#define BENCH_BATCH 64		// edges per decoder_feed()
+
+typedef struct {
+	const char *name;
+	double jitter;		// msec
+	double dropout;
+	double glitch;
+	double drift;		// ppm
+	int inverted;
+} profile_t;
+
+static const profile_t profile[] = {
+	{ "clean",    0.0, 0.00, 0.0,   0.0, 0 },
+	{ "jitter",   3.0, 0.00, 0.0,   0.0, 0 },
+	{ "dropout",  0.0, 0.02, 0.0,   0.0, 0 },
+	{ "glitch",   0.0, 0.00, 0.3,   0.0, 0 },
+	{ "drift",    0.0, 0.00, 0.0, 200.0, 0 },
+	{ "inverted", 1.0, 0.00, 0.0,   0.0, 1 },
+	{ "noisy",    5.0, 0.02, 0.5,  50.0, 0 },
+	{ "bad",      8.0, 0.05, 1.5,  50.0, 0 },
+	{ NULL,       0.0, 0.00, 0.0,   0.0, 0 }
+};
+
+typedef struct {
+	int64_t  total_ns;
+	int64_t  check_ns;
+	uint64_t check_cnt;
+	uint64_t minutes;
+	uint64_t stamps;
+	uint64_t wrong;
+	double   first;		// minutes until the first stamp, < 0 for never
+} result_t;
+
+
+
+static int64_t now_ns (void) {
+
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+
+// generate all edges of a profile into one array
+static edge_t *generate (const profile_t *prof, int minutes, size_t *count) {
+
+	signal_config_t cfg;
+	signal_t sig;
+	edge_t *edge = NULL, *tmp;
+	size_t size = 0, got;
+
+	memset (&cfg, 0, sizeof (cfg));
+	cfg.start = BENCH_START;
+	cfg.end = BENCH_START + minutes * 60;
+	cfg.jitter = prof->jitter * 1000000.0;
+	cfg.dropout = prof->dropout;
+	cfg.glitch = prof->glitch;
+	cfg.drift = prof->drift;
+	cfg.mono = 1000000000000LL;
+	cfg.pin[0] = 0;
+	cfg.pin[1] = prof->inverted ? 1 : -1;
+	cfg.seed = 77;
+
+	signal_init (&sig, &cfg);
+	*count = 0;
+
+	do {
+		if (*count + 1024 > size) {
+			size = size ? size * 2 : 65536;
+			if ((tmp = realloc (edge, size * sizeof (edge_t))) == NULL) {
+				free (edge);
+				return NULL;
+			}
+			edge = tmp;
+		}
+		got = signal_edges (&sig, &edge[*count], 1024);
+		*count += got;
+	} while (got);
+
+	return edge;
+}
+
+
+
+// push all edges through a fresh decoder, stdout of the decoder is discarded
+static void run (const edge_t *edge, size_t count, long tolerance, result_t *res) {
+
+	dcf77_decoder dec;
+	dcf77_result result;
+	int64_t start;
+	size_t i, batch;
+	int out, null;
+
+	memset (res, 0, sizeof (*res));
+	res->first = -1.0;
+
+	decoder_init (&dec, tolerance, 0);
+	dec.bench = 1;
+
+	fflush (stdout);
+	out = dup (STDOUT_FILENO);
+	if ((null = open ("/dev/null", O_WRONLY)) >= 0) {
+		dup2 (null, STDOUT_FILENO);
+		close (null);
+	}
+
+	start = now_ns ();
+	for (i = 0 ; i < count ; i += batch) {
+		batch = count - i < BENCH_BATCH ? count - i : BENCH_BATCH;
+		decoder_feed (&dec, &edge[i], batch);
+		while (decoder_poll (&dec, &result)) {
+			if (result.type != RESULT_MINUTE) continue;
+			res->minutes++;
+			if (result.time.stamp == 0) continue;
+			res->stamps++;
+			if (result.time.stamp != result.edge.clock.tv_sec + (result.edge.clock.tv_nsec >= 500000000L)) res->wrong++;
+			if (res->first < 0.0) res->first = (result.edge.clock.tv_sec - edge[0].real / 1000000000LL) / 60.0;
+		}
+	}
+	res->total_ns = now_ns () - start;
+
+	fflush (stdout);
+	if (out >= 0) {
+		dup2 (out, STDOUT_FILENO);
+		close (out);
+	}
+
+	res->check_ns = dec.check_ns;
+	res->check_cnt = dec.check_cnt;
+}
+
+
+
+static void report (const char *name, size_t count, const result_t *res) {
+
+	double sec = res->total_ns * 1e-9;
+
+	printf ("%-10s %9zu %12.0f %10.1f %8.1f %8.1f %7" PRIu64 " %7" PRIu64 " %6" PRIu64, name, count,
+		count / sec, res->minutes / sec,
+		(double) (res->total_ns - res->check_ns) / count,
+		res->check_cnt ? (double) res->check_ns / res->check_cnt : 0.0,
+		res->minutes, res->stamps, res->wrong);
+
+	if (res->first >= 0.0) printf (" %7.1f\n", res->first);
+	else printf ("      --\n");
+}
+
+
+
+static void bench (const char *name, const edge_t *edge, size_t count, long tolerance, int runs) {
+
+	result_t res, best;
+	int i;
+
+	for (i = 0 ; i < runs ; i++) {
+		run (edge, count, tolerance, &res);
+		if (i == 0 || res.total_ns < best.total_ns) best = res;
+	}
+	report (name, count, &best);
+}
+
+
+
+int main (int argc, char *argv[])
+{
+
+	const profile_t *prof;
+	const edge_t *trace;
+	edge_t *edge;
+	char trace_name[256] = "", profile_name[32] = "";
+	size_t count;
+	long tolerance = 25000000L;
+	int minutes = 1440, runs = 3, i;
+
+	while ((i = getopt (argc, argv, "hm:n:p:r:t:")) != -1) {
+		switch (i) {
+
+			case 'h':
+				fprintf (stderr, "Usage: %s [-h] [-m <minutes>] [-n <runs>] [-p <profile>] [-r <trace>] [-t <msec>]\n", argv[0]);
+				fprintf (stderr, "    -h            this helptext\n");
+				fprintf (stderr, "    -m <minutes>  length of the synthetic signals (default: 1440)\n");
+				fprintf (stderr, "    -n <runs>     runs per signal, the fastest is reported (default: 3)\n");
+				fprintf (stderr, "    -p <profile>  only this noise profile:");
+				for (prof = profile ; prof->name ; prof++) fprintf (stderr, " %s", prof->name);
+				fprintf (stderr, "\n");
+				fprintf (stderr, "    -r <trace>    benchmark a recorded trace instead of the profiles\n");
+				fprintf (stderr, "    -t <msec>     tolerance in milliseconds (default: 25)\n");
+				return EXIT_FAILURE;
+
+			case 'm':
+				minutes = atoi (optarg);
+				break;
+
+			case 'n':
+				runs = atoi (optarg);
+				break;
+
+			case 'p':
+				strncpy (profile_name, optarg, 31);
+				break;
+
+			case 'r':
+				strncpy (trace_name, optarg, 255);
+				break;
+
+			case 't':
+				tolerance = strtol (optarg, NULL, 10) * 1000000L;
+				break;
+
+			default:
+				fprintf(stderr, "See '%s -h' for more information.\n", argv[0]);
+				return EXIT_FAILURE;
+
+		}
+	}
+
+	if (minutes < 1) minutes = 1;
+	if (runs < 1) runs = 1;
+
+	printf ("%-10s %9s %12s %10s %8s %8s %7s %7s %6s %7s\n", "signal", "edges", "edges/s", "minutes/s", "ns/edge", "ns/check", "minutes", "stamps", "wrong", "1st/min");
+
+	if (trace_name[0] != '\0') {
+		if ((trace = trace_map (trace_name, &count)) == NULL || count == 0) {
+			fprintf (stderr, "Can't read trace '%s'! exit.\n", trace_name);
+			return EXIT_FAILURE;
+		}
+		bench ("trace", trace, count, tolerance, runs);
+		return EXIT_SUCCESS;
+	}
+
+	for (prof = profile ; prof->name ; prof++) {
+		if (profile_name[0] != '\0' && strcmp (profile_name, prof->name)) continue;
+		if ((edge = generate (prof, minutes, &count)) == NULL) {
+			fprintf (stderr, "Out of memory! exit.\n");
+			return EXIT_FAILURE;
+		}
+		bench (prof->name, edge, count, tolerance, runs);
+		free (edge);
+	}
+
+	return EXIT_SUCCESS;
+}
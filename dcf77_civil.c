@@ -0,0 +1,80 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * civil calendar and CET/CEST.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "dcf77_civil.h"
+
+static const int8_t month_days[12] = {
+	31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+
+
+// days since 1970-01-01 of a date in the proleptic gregorian calendar
+int64_t days_from_civil (int year, int mon, int day) {
+
+	int64_t era;
+	int yoe, doy, doe;
+
+	year -= mon <= 2;
+	era = (year >= 0 ? year : year - 399) / 400;
+	yoe = year - era * 400;
+	doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+
+
+void civil_from_days (int64_t days, int *year, int *mon, int *day) {
+
+	int64_t era;
+	int doe, yoe, doy, mp;
+
+	days += 719468;
+	era = (days >= 0 ? days : days - 146096) / 146097;
+	doe = days - era * 146097;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+
+	*day = doy - (153 * mp + 2) / 5 + 1;
+	*mon = mp < 10 ? mp + 3 : mp - 9;
+	*year = yoe + era * 400 + (*mon <= 2);
+}
+
+
+
+// days of month 'mon' (1 to 12) in the two digit 'year' of DCF77, february has 29 if the year is unknown (< 0)
+int civil_month_days (const int mon, const int year) {
+
+	if (mon < 1 || mon > 12) return 0;
+	return month_days[mon - 1] + (mon == 2 && (year < 0 || year % 4 == 0));
+}
+
+
+
+// start of the last sunday in a month at 01:00 UTC
+static time_t last_sunday (int year, int mon) {
+
+	int64_t days = days_from_civil (year, mon, 31);
+
+	days -= (days + 4) % 7;
+	return days * 86400 + 3600;
+}
+
+
+
+// return 1 if central european summer time is in effect at 't' (UTC)
+int civil_cest (const time_t t) {
+
+	int year, mon, day;
+
+	civil_from_days (t / 86400, &year, &mon, &day);
+	return t >= last_sunday (year, 3) && t < last_sunday (year, 10);
+}
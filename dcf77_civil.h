@@ -0,0 +1,21 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * civil calendar and CET/CEST without the time zone database of libc.
+ *
+ * Days are counted from 1970-01-01 in the proleptic gregorian calendar,
+ * CEST is in effect from the last sunday of march to the last sunday
+ * of october, both at 01:00 UTC. All of it is reentrant and constant time.
+ */
+
+#ifndef DCF77_CIVIL_H
+#define DCF77_CIVIL_H
+
+#include <stdint.h>
+#include <time.h>
+
+int64_t days_from_civil (int year, int mon, int day);
+void civil_from_days (int64_t days, int *year, int *mon, int *day);
+int civil_month_days (const int mon, const int year);
+int civil_cest (const time_t t);
+
+#endif
@@ -17,7 +17,21 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <signal.h>
-#include <wiringPi.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "dcf77_trace.h"
+#include "dcf77_decoder.h"
+#include "dcf77_fusion.h"
+#include "dcf77_source.h"
+#include "dcf77_state.h"
+#include "dcf77_metrics.h"
+#include "dcf77_event.h"
+#include "dcf77_publish.h"
 
 #ifndef SYS_WINNT
 #include <sys/types.h>
@@ -31,6 +45,9 @@
 
 // #define TOLERANCE_MICRO 40000000L
 
+// wake up without edges only to detect a lost signal (milliseconds)
+#define SIGNAL_TIMEOUT 3000
+
 // defined in ntp.h
 #define NTPD_BASE 0x4e545030
 #define LEAP_NOWARNING	0x0	// normal, no leap second warning
@@ -50,777 +67,858 @@ struct shmTime {
 	int    precision;
 	int    nsamples;
 	int    valid;
-	int    dummy[10];
+	unsigned clockTimeStampNSec;	// unsigned ns timestamps
+	unsigned receiveTimeStampNSec;
+	int    dummy[8];
+};
+
+// defined in refclock_sock.c of chrony, chronyd is the server of the datagram socket
+#define SOCK_MAGIC 0x534f434b
+
+struct sock_sample {
+	struct timeval tv;	// system time of the sample
+	double offset;		// reference time - system time in sec
+	int pulse;			// only the second, no absolute time
+	int leap;			// 0 - normal, 1 - insert, 2 - delete leap second
+	int _pad;
+	int magic;			// SOCK_MAGIC
 };
 
+// lock-free single-producer / single-consumer ring of edges
+// the producer (a thread of the source) only writes 'head' and 'lost', the consumer only writes 'tail'
+#define EDGE_QUEUE_SIZE 256	// must be a power of two
+
+typedef struct {
+	edge_t   edge[EDGE_QUEUE_SIZE];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t lost;
+} edge_queue_t;
+
+// the same for the results of a single receiver, from its decoder thread to the output
+#define RESULT_QUEUE_SIZE 64	// must be a power of two
+
 typedef struct {
-	struct timespec time;
-	struct timespec clock;
-} time_info_t;
+	dcf77_result res[RESULT_QUEUE_SIZE];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t lost;
+} result_queue_t;
+
+// the same for the text of '-D' of a receiver, so its decoder thread never writes to stdout
+#define TEXT_QUEUE_SIZE 65536	// must be a power of two
 
 typedef struct {
-	int8_t min;
-	int8_t min_chk;
-	int8_t hour;
-	int8_t hour_chk;
-	int8_t day;
-	int8_t day_chk;
-	int8_t wday;
-	int8_t wday_chk;
-	int8_t mon;
-	int8_t mon_chk;
-	int8_t year;
-	int8_t year_chk;
-	int8_t tz;
-	int8_t tz_chk;
-	int8_t dst;
-	int8_t lsec;
-	int8_t alert;
-	int8_t check;
-	int8_t stamp_chk;
-	time_t stamp;
-} dcf77_time;
+	char text[TEXT_QUEUE_SIZE];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t lost;
+} text_queue_t;
 
 typedef struct {
 	char string[128];
 	int block;
 } dcf77_data;
 
-typedef void (sigfunk) (int);
+// everything that is done with the results of one decoder
+typedef struct {
+	volatile struct shmTime *ntp_shm;
+	int sock_fd;		// samples to the SOCK refclock of chrony, -1 if none
+	struct sockaddr_un sock_addr;
+	char fifo_name[256];
+	publish_t *pub;		// the data to the clients of a socket, NULL if none
+	dcf77_data block_data;
+	const char *name;	// prefix of the replay lines
+	int replay;
+	int64_t delay;		// delay of the receiver in nsec, subtracted from the receive timestamp
+	int calibrate;		// learn 'delay' from the offset to the system clock
+	int seconds;		// a sample on every second mark, not only on the minute marker
+	int synced;			// the last minute was published, the system clock is not far off
+	event_ring *log;	// the samples go to the event log, NULL if off
+	unsigned int calibrated;
+} output_t;
+
+// one trace, replayed in its own thread
+#define REPLAY_MAX   64
+#define REPLAY_BATCH 64
 
-char *weekday[8] = {
-	" --none-- ", "Monday    ", "Tuesday   ", "Wednesday ", "Thursday  ", "Friday    ", "Saturday  ", "Sunday    "
-};
+typedef struct {
+	const edge_t *edge;
+	size_t count;
+	long tolerance;
+	output_t out;
+	pthread_t thread;
+	int running;
+} replay_t;
+
+// one receiver module, on one pin or on two pins with inverted outputs
+// one queue per pin, so every thread of the source is the only producer of its queue
+typedef struct {
+	int pin[2];
+	edge_queue_t queue[2];
+	int event;			// signaled by the producers after every edge, the decoder sleeps on it
+	result_queue_t results;	// to the output, with only one receiver
+	text_queue_t text;		// to the output, with '-D'
+// written by the decoder thread, printed by the output, so the decoder never waits for stdout
+	unsigned int stats_seen;
+	unsigned int stats_done;	// 'stats' holds the snapshot of this request
+	dcf77_stats stats;
+	int sig_lost;			// no edge for SIGNAL_TIMEOUT
+	uint32_t trace_err;		// failed writes of the trace, the last one with 'trace_errno'
+	int trace_errno;
+// of the output
+	unsigned int stats_shown;
+	int sig_shown;
+	uint32_t trace_err_last;
+	uint32_t lost_last;
+	uint32_t text_lost_last;
+	int src_done;		// the source has pushed its last edge
+	dcf77_decoder dec;
+	pthread_t thread;
+	int running;
+	int index;
+	edge_source src;
+} receiver_t;
+
+typedef void (sigfunk) (int);
 
 static int flag_debug = 0;
 static int flag_run = 1;
-static time_info_t sig_now;
 
-void edge_sig (void) {
-	clock_gettime (CLOCK_MONOTONIC_RAW, &sig_now.time);
-	clock_gettime (CLOCK_REALTIME, &sig_now.clock);
-}
+// incremented by SIGUSR1, every receiver prints its statistics once
+static volatile unsigned int stats_req = 0;
 
-static void quit (int signr) {
-	flag_run = 0;
-	return;
-}
+static receiver_t receiver[RECEIVER_MAX];
+static int receiver_cnt = 0;
+static int receiver_end = 0;	// receivers whose source has ended and whose edges are decoded
 
+// what the decoders have learned, kept over a restart
+static dcf77_state *state = NULL;
 
-void write_bcd (char *data, int8_t num) {
+// counters of the receivers for monitoring
+static dcf77_metrics *metrics = NULL;
 
-	uint8_t i, high, low;
+// binary records of the decoders and the output, written by a thread of its own
+static event_log events;
+static int events_on = 0;
 
-	low = num % 10;
-	high = num / 10;
+// clients of the third-party data
+static publish_t publisher;
+static int publisher_on = 0;
 
-	for (i = 0 ; i < 4 ; i++) {
-		data[i]   = low  & (1 << i) ? '1' : '0';
-		data[i+4] = high & (1 << i) ? '1' : '0';
-	}
-}
+// the receiver threads hand over their frames, the main thread publishes the fused minutes
+static dcf77_fusion fusion;
+static pthread_mutex_t fusion_lock = PTHREAD_MUTEX_INITIALIZER;
 
+// the receiver threads signal new results, the main thread is the output and sleeps on it
+static int output_event = -1;
 
+// edges of a single receiver recorded by its decoder thread, -1 if none
+static int trace_fd = -1;
 
-void get_diff (struct timespec *diff, const time_info_t const *old, const time_info_t const *new, const long tolerance) {
 
-	diff->tv_sec = new->time.tv_sec - old->time.tv_sec;
-	diff->tv_nsec = (new->time.tv_nsec - old->time.tv_nsec) + tolerance;
 
-	if (diff->tv_nsec >= 1000000000L) {
-		diff->tv_sec++;
-		diff->tv_nsec -= 1000000000L;
-	}
+int edge_queue_push (edge_queue_t *queue, const edge_t *edge) {
+
+	uint32_t head = queue->head;
+	uint32_t tail = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE);
 
-	if (diff->tv_nsec < 0L) {
-		diff->tv_sec--;
-		diff->tv_nsec += 1000000000L;
+	if (head - tail >= EDGE_QUEUE_SIZE) {
+		__atomic_store_n (&queue->lost, queue->lost + 1, __ATOMIC_RELAXED);
+		return 0;
 	}
+
+	queue->edge[head & (EDGE_QUEUE_SIZE - 1)] = *edge;
+	__atomic_store_n (&queue->head, head + 1, __ATOMIC_RELEASE);
+	return 1;
 }
 
 
 
-int check_tolerance (struct timespec *diff, const long sec, const long nsec, const long tolerance) {
+size_t edge_queue_pop (edge_queue_t *queue, edge_t *edge, size_t max) {
 
-//	printf ("check tolerance %ld %10ld <-> %ld %10ld (%ld) ... ", diff->tv_sec, diff->tv_nsec, sec, nsec, tolerance);
+	uint32_t tail = queue->tail;
+	uint32_t head = __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE);
+	size_t count = 0;
 
-	if (diff->tv_sec == sec && diff->tv_nsec >= nsec && diff->tv_nsec <= (nsec + (2 * tolerance))) {
-//		printf ("ok\n");
-		return 1;
-	}
-//	printf ("fail\n");
-	return 0;
+	while (tail != head && count < max) edge[count++] = queue->edge[tail++ & (EDGE_QUEUE_SIZE - 1)];
+
+	__atomic_store_n (&queue->tail, tail, __ATOMIC_RELEASE);
+	return count;
 }
 
 
 
-int get_second (const struct timespec const *diff, const time_info_t const *min, const time_info_t const *sig, const long tolerance) {
+void edge_wakeup (int event) {
 
-	struct timespec sec_diff;
-	int second = 0;
+	uint64_t one = 1;
 
-	if (min->time.tv_sec) {
-		get_diff (&sec_diff, min, sig, tolerance);
-		second = sec_diff.tv_sec;
-	}
+	if (event < 0) return;
 
-	return second;
+// EAGAIN only means the counter is full, the decoder gets woken up anyway
+	if (write (event, &one, sizeof (one)) < 0) return;
 }
 
 
 
-// return 1 if parity is okay
-int check_parity (int8_t *data, size_t count) {
+// wait until edges are queued or the timeout (milliseconds) expires
+// return 1 on wakeup, 0 on timeout
+int edge_wait (int event, int timeout) {
 
-	if (data[0] < 0) return 0;
+	struct pollfd pfd;
+	uint64_t count;
+	int ret;
 
-	size_t i;
-	int  parity = 0, fail = 0;
+	pfd.fd = event;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
 
-// can't check without parity
-	if (data[count - 1] < 0) return 0;
+	ret = poll (&pfd, 1, timeout);
+	if (ret <= 0) return ret < 0 && errno == EINTR;
 
-// count one's and fail's
-	for (i = 0 ; i < count - 1 ; i++) {
-		if (data[i] < 0) fail++;
-		else parity += data[i];
-	}
+	if (read (event, &count, sizeof (count)) < 0 && errno != EAGAIN) return 0;
+	return 1;
+}
 
-// can't check with more then one fail's
-	if (fail > 1) return 0;
 
-// correct only one fail
-	if (fail > 0) {
-		for (i = 0 ; i < count ; i++) {
-			if (data[i] < 0) {
-				if ((data[i] = (parity + data[count]) % 2)) parity++;
-				break;
-			}
-		}
-	}
 
-	if (parity % 2 == data[count - 1]) {
-		if (fail) return 0;
-		else return 1;
-	}
-	return -1;
-}
+// the sink of the source of a receiver
+static size_t edge_push (void *arg, const int idx, const edge_t *edge, const size_t count) {
 
+	receiver_t *rcv = arg;
+	size_t i, max = count, room;
 
+	if (rcv->src.wait) {
+		room = EDGE_QUEUE_SIZE - (rcv->queue[idx].head - __atomic_load_n (&rcv->queue[idx].tail, __ATOMIC_ACQUIRE));
+		if (max > room) max = room;
+	}
+
+	for (i = 0 ; i < max && edge_queue_push (&rcv->queue[idx], &edge[i]) ; i++);
+	if (i) edge_wakeup (rcv->event);
+	return i;
+}
 
-// return the number if it is in possible range from start to end
-// otherwise return -1
 
-int check_number (int8_t *data, size_t count, int start, int end) {
 
-	if (data[0] < 0) return -1;
+int result_queue_push (result_queue_t *queue, const dcf77_result *res) {
 
-	size_t i = 0;
-	int number = 0;
+	uint32_t head = queue->head;
+	uint32_t tail = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE);
 
-	for (i = 0 ; i < count ; i++) {
-		if (data[i] < 0) break;
-		if (data[i] == 1) number += (1 << (i % 4));
+	if (head - tail >= RESULT_QUEUE_SIZE) {
+		__atomic_store_n (&queue->lost, queue->lost + 1, __ATOMIC_RELAXED);
+		return 0;
 	}
 
-	if (i < count || number < start || number > end) return -1;
-	return number;
+	queue->res[head & (RESULT_QUEUE_SIZE - 1)] = *res;
+	__atomic_store_n (&queue->head, head + 1, __ATOMIC_RELEASE);
+	return 1;
 }
 
 
 
-int check_data_sync (int8_t *data) {
+int result_queue_pop (result_queue_t *queue, dcf77_result *res) {
 
-	int check = 0;
+	uint32_t tail = queue->tail;
 
-	if (data[0] == 0) check++;
-	else if (data[0] == 1) check--;
+	if (tail == __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE)) return 0;
 
-	return check;
+	*res = queue->res[tail & (RESULT_QUEUE_SIZE - 1)];
+	__atomic_store_n (&queue->tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
 }
 
 
 
-int check_data_tz (int8_t *data, int8_t *tz) {
-
-	int check = -1;
+// a text that does not fit is dropped as a whole, so the lines stay complete
+int text_queue_push (text_queue_t *queue, const char *text, const size_t len) {
 
-	if      (data[17] == 0 && data[18] == 1) *tz = 1;
-	else if (data[17] == 1 && data[18] == 0) *tz = 2;
-	else *tz = -1;
+	uint32_t head = queue->head;
+	uint32_t tail = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE);
+	size_t i;
 
-	if (*tz > 0) check = 1;
+	if (len > TEXT_QUEUE_SIZE - (head - tail)) {
+		__atomic_store_n (&queue->lost, queue->lost + 1, __ATOMIC_RELAXED);
+		return 0;
+	}
 
-	return check;
+	for (i = 0 ; i < len ; i++) queue->text[(head + i) & (TEXT_QUEUE_SIZE - 1)] = text[i];
+	__atomic_store_n (&queue->head, head + len, __ATOMIC_RELEASE);
+	return 1;
 }
 
 
 
-int check_data_time (int8_t *data) {
+void text_queue_print (text_queue_t *queue, FILE *file) {
 
-	int check;
+	uint32_t tail = queue->tail;
+	uint32_t head = __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE);
+	uint32_t start = tail & (TEXT_QUEUE_SIZE - 1);
 
-	if (data[20] == 1) check = 1;
-	else check = -1;
+	if (head == tail) return;
 
-	return check;
+	if (start + (head - tail) > TEXT_QUEUE_SIZE) {
+		fwrite (&queue->text[start], 1, TEXT_QUEUE_SIZE - start, file);
+		fwrite (queue->text, 1, (head - tail) - (TEXT_QUEUE_SIZE - start), file);
+	}
+	else {
+		fwrite (&queue->text[start], 1, head - tail, file);
+	}
+	__atomic_store_n (&queue->tail, head, __ATOMIC_RELEASE);
 }
 
 
 
-void check_data_min (int8_t *data, int8_t *min) {
-	if (check_parity (&data[21], 8) > 0) {
-		*min = check_number (&data[21], 4, 0, 9);
-		if (*min >= 0) *min += check_number (&data[25], 3, 0, 5) * 10;
-		if (*min < 0 || *min > 59) *min = -1;
-	}
-}
+// drain both queues of a receiver and merge them in order of time
+size_t get_edges (receiver_t *rcv, edge_t *batch) {
 
+	edge_t pin_edge[2][EDGE_QUEUE_SIZE];
+	size_t count[2], i = 0, j = 0, k = 0;
 
+	count[0] = edge_queue_pop (&rcv->queue[0], pin_edge[0], EDGE_QUEUE_SIZE);
+	count[1] = edge_queue_pop (&rcv->queue[1], pin_edge[1], EDGE_QUEUE_SIZE);
 
-void check_data_hour (int8_t *data, int8_t *hour) {
-	if (check_parity (&data[29], 7) > 0) {
-		*hour = check_number (&data[29], 4, 0, 9);
-		if (*hour >= 0) *hour += check_number (&data[33], 2, 0, 2) * 10;
-		if (*hour < 0 || *hour > 23) *hour = -1;
+	while (i < count[0] || j < count[1]) {
+		if (j >= count[1] || (i < count[0] && pin_edge[0][i].mono <= pin_edge[1][j].mono))
+			batch[k++] = pin_edge[0][i++];
+		else
+			batch[k++] = pin_edge[1][j++];
 	}
+
+	return k;
 }
 
 
 
-void check_data_dst (int8_t *data, int8_t hour, int8_t *dst) {
-	*dst = data[16];
-	if (*dst == 1 && hour < 1 && hour > 4) *dst = 0;
-}
 
+static void stats_signal (int signr) {
 
+	int i;
 
-void check_data_day (int8_t *data, int8_t *day) {
-	*day = check_number (&data[36], 4, 0, 9);
-	if (*day >= 0) *day += check_number (&data[40], 2, 0, 3) * 10;
-	if (*day < 1 || *day > 31) *day = -1;
+	stats_req++;
+	for (i = 0 ; i < receiver_cnt ; i++) edge_wakeup (receiver[i].event);
+	return;
 }
 
 
 
-void check_data_wday (int8_t *data, int8_t *wday) {
-	*wday = check_number (&data[42], 3, 1, 7);
+static void quit (int signr) {
+
+	int i;
+
+	__atomic_store_n (&flag_run, 0, __ATOMIC_RELEASE);
+	for (i = 0 ; i < receiver_cnt ; i++) edge_wakeup (receiver[i].event);
+	edge_wakeup (output_event);
+	return;
 }
 
 
+void write_bcd (char *data, int8_t num) {
+
+	uint8_t i, high, low;
 
-void check_data_mon (int8_t *data, int8_t *mon) {
-	*mon = check_number (&data[45], 4, 0, 9);
-	if (*mon >= 0 && data[49] > 0) *mon += data[49] * 10;
-	if (*mon < 1 || *mon > 12) *mon = -1;
+	low = num % 10;
+	high = num / 10;
+
+	for (i = 0 ; i < 4 ; i++) {
+		data[i]   = low  & (1 << i) ? '1' : '0';
+		data[i+4] = high & (1 << i) ? '1' : '0';
+	}
 }
 
 
 
-void check_data_year (int8_t *data, int8_t *year) {
-	*year = check_number (&data[50], 4, 0, 9);
-	if (*year >= 0) *year += check_number (&data[54], 4, 0, 9) * 10;
-	if (*year < 0 || *year > 99) *year = -1;
+void init_dcf77_data (dcf77_data *data) {
+	memset (data->string, '\0', 128);
+	data->block = 0;
 }
 
 
 
-int check_data_date (int8_t *data) {
+void gather_data (dcf77_data *data, const int8_t *clock_data, const dcf77_time *time, const char *fifo_name, publish_t *pub) {
 
-	int check = 0;
+	int i, fifo;
 
-	check += check_parity (&data[36], 23);
+	if (strlen(fifo_name) == 0 && pub == NULL) return;
+	if (time->stamp == 0 || time->tz < 0 || time->wday < 0) return;
 
-	return check;
-}
+	data->block = time->min % 3;
+	if (data->block == 0) init_dcf77_data (data);
 
+	for (i = 0 ; i < 14 ; i++) data->string[data->block * 14 + i] = '0' + clock_data[i + 1];
 
+	if (data->block == 2) {
+		write_bcd (&data->string[42], time->min);
+		write_bcd (&data->string[50], time->hour);
+		write_bcd (&data->string[58], time->day);
+		write_bcd (&data->string[66], time->mon);
+		write_bcd (&data->string[71], time->wday);
+		write_bcd (&data->string[74], time->year);
+		data->string[82] = '+';
 
-int check_data_lsec (int8_t *data, int8_t *lsec, int8_t day, int8_t mon) {
+		if (time->tz > 0)
+			data->string[83] = '0' + time->tz;
+		else
+			data->string[83] = '0';
 
-	*lsec = data[19];
+		data->string[84] = '\n';
+		data->string[85] = '\0';
+	}
 
-	if (*lsec == 1) {
-		if ((mon == 6 && day == 30) || (mon == 12 && day == 31) || (mon == 3 && day == 31) || (mon == 9 && day == 30)) {
-			return 1;
+	if (flag_debug) {
+		for (i = 0 ; i < 82 ; i++) {
+			if (i == 14 || i == 28 || i == 42) printf (" ");
+			if (data->string[i] == '\0') printf ("_");
+			else printf ("%c", data->string[i]);
 		}
-		else {
-			*lsec = -5;
-			return -1;
+		printf ("\n");
+		fflush (stdout);
+	}
+
+	if (data->block == 2) {
+		if (data->string[0] && data->string[14] && data->string[28]) {
+			if (fifo_name[0] != '\0' && (fifo = open (fifo_name, O_WRONLY | O_NONBLOCK)) >= 0) {
+				write(fifo, data->string, strlen(data->string));
+				close (fifo);
+			}
+			if (pub) publish_block (pub, data->string);
 		}
+		data->string[0] = '\0';
 	}
-	if (*lsec == 0) return 1;
+}
+
+
+
+static volatile struct shmTime *getShmTime (int unit) {
+
+	int shmid;
+	volatile struct shmTime *ntp_shm;
+
+	shmid = shmget (NTPD_BASE + unit, sizeof (struct shmTime), IPC_CREAT | 0777);
+	if (shmid == -1) return NULL;
+
+	ntp_shm = (struct shmTime *) shmat (shmid, NULL, 0);
+	if (ntp_shm == (void *) -1) return NULL;
+
+	ntp_shm->valid = 0;
+	ntp_shm->mode = 1;
+	ntp_shm->count = 0;
+
+	return ntp_shm;
 
-	return 0;
 }
 
 
 
-void output_time (dcf77_time *time) {
-	printf("Date   : %s, ", time->wday > 0 ? weekday[time->wday] : "-- n/a -- ");
-	if (time->day > 0) printf("%02d.", time->day);
-	else  printf("--.");
-	if (time->mon > 0) printf("%02d.", time->mon);
-	else  printf("--.");
-	if (time->year >= 0) printf("%4d ", 2000 + time->year);
-	else  printf("---- ");
-	if (time->hour >= 0) printf("%02d:", time->hour);
-	else  printf("--:");
-	if (time->min  >= 0) printf("%02d ", time->min);
-	else  printf("-- ");
-	if (time->tz > 0) printf ("%s", time->tz == 1 ? "CET" : "CEST");
-	else printf ("---");
-	if (time->stamp != 0)
-		printf(" (Stamp: %ld / Confirm: %d)", time->stamp, time->stamp_chk);
+// the receive timestamp is the filtered minute marker minus the delay of the receiver
+void set_ntp_shm (volatile struct shmTime *ntp_shm, const dcf77_result *res, const int64_t delay) {
+
+	int64_t receive = res->mark.clock.tv_sec * 1000000000LL + res->mark.clock.tv_nsec - delay;
+
+	ntp_shm->valid = 0;
+
+	ntp_shm->clockTimeStampSec = res->time.stamp;
+	ntp_shm->clockTimeStampUSec = 0;
+	ntp_shm->clockTimeStampNSec = 0;
+
+	ntp_shm->receiveTimeStampSec = receive / 1000000000LL;
+	ntp_shm->receiveTimeStampUSec = (receive % 1000000000LL) / 1000;
+	ntp_shm->receiveTimeStampNSec = receive % 1000000000LL;
+
+	ntp_shm->precision = res->precision;
+
+	if (res->time.lsec > 0)
+		ntp_shm->leap = LEAP_ADDSECOND;
 	else
-		printf ("\nConfirm:    %2d       %2d %2d  %2d  %2d %2d %2d", time->wday_chk, time->day_chk, time->mon_chk, time->year_chk, time->hour_chk, time->min_chk, time->tz_chk);
-	printf("\n");
+		ntp_shm->leap = LEAP_NOWARNING;
 
-	if (time->dst  == 1) printf("DST change at end of this hour!\n");
-	if (time->lsec  > 0) printf("Leap-Second at end of this day!\n");
-	if (time->alert)     printf("DCF77-Transmitter set ALERT!\n");
+	ntp_shm->count++;
+	ntp_shm->valid = 1;
 }
 
 
 
-void add_minute (dcf77_time *dcf, time_info_t *info, const int count) {
+// a datagram socket to send the samples to 'path', return the socket or -1 on error
+static int getChronySock (const char *path, struct sockaddr_un *addr) {
 
-	if (info->time.tv_sec) {
-		info->time.tv_sec += count * 60;
-		info->clock.tv_sec += count * 60;
-	}
+	if (strlen (path) >= sizeof (addr->sun_path)) return -1;
 
-	if (dcf->stamp) dcf->stamp += count * 60;
-
-	if (dcf->min  >= 0) {
-		dcf->min += count;
-		if (dcf->min / 60) {
-
-			if (dcf->hour >= 0) {
-				dcf->hour += dcf->min / 60;
-				if (dcf->hour / 24) {
-
-					if (dcf->wday > 0) {
-						dcf->wday += dcf->hour / 24;
-						if (dcf->wday > 7) dcf->wday -= 7;
-					}
-
-					if (dcf->day >= 0) {
-						dcf->day  += dcf->hour / 24;
-						if (dcf->mon > 0) {
-							if      (dcf->mon == 2 && dcf->year >= 0 && dcf->day > 28 && dcf->year % 4) { dcf->day = 1; dcf->mon++; }
-							else if (dcf->mon == 2 && dcf->year >= 0 && dcf->day > 29 && dcf->year % 4 == 0) { dcf->day = 1; dcf->mon++; }
-							else if ((dcf->mon == 4 || dcf->mon == 6 || dcf->mon == 9 || dcf->mon == 11) && dcf->day > 30) { dcf->day = 1; dcf->mon++; }
-							else if ((dcf->mon == 1 || dcf->mon == 3 || dcf->mon == 5 || dcf->mon == 7 || dcf->mon == 8 || dcf->mon == 10 || dcf->mon == 12) && dcf->day > 31) { dcf->day = 1; dcf->mon++; }
-							if (dcf->year >= 0) {
-								if (dcf->mon > 12) {
-									dcf->mon = 1;
-									dcf->year++;
-									if (dcf->year > 99) dcf->year = 0;
-								}
-							}
-						}
-					}
-					dcf->hour %= 24;
-				}
-			}
-			dcf->min %= 60;
-		}
-	}
-}
+	memset (addr, 0, sizeof (*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy (addr->sun_path, path);
 
+	return socket (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+}
 
 
-void check_data (int8_t *data, dcf77_time *now, dcf77_time *last) {
 
-	struct tm dcf_time;
-	int check = 0;
+// same sample as for the SHM, sent the moment the minute is decoded
+// chronyd may not run yet or be restarted, so every sample is sent to the path again
+void set_chrony_sock (output_t *out, const dcf77_result *res) {
 
-	now->check = 0;
+	struct sock_sample sample;
+	int64_t receive = res->mark.clock.tv_sec * 1000000000LL + res->mark.clock.tv_nsec - out->delay;
 
-	now->check += check_data_sync (data);
-	now->check += check_data_time (data);
-	now->check += check_data_tz   (data, &now->tz);
-	check_data_min  (data, &now->min);
-	check_data_hour (data, &now->hour);
-	check_data_dst  (data, now->hour, &now->dst);
-	check_data_day  (data, &now->day);
-	check_data_wday (data, &now->wday);
-	check_data_mon  (data, &now->mon);
-	check_data_year (data, &now->year);
-	now->check += check_data_date (data);
-	now->check += check_data_lsec (data, &now->lsec, now->day, now->mon);
-	if (now->lsec == -5) now->lsec = 0;
-	if (data[15] == 1) now->alert = 1;
+	memset (&sample, 0, sizeof (sample));
+	sample.tv.tv_sec = receive / 1000000000LL;
+	sample.tv.tv_usec = (receive % 1000000000LL) / 1000;
+	sample.offset = (res->time.stamp - sample.tv.tv_sec) - 0.000001 * sample.tv.tv_usec;
+	sample.pulse = 0;
+	sample.leap = res->time.lsec > 0 ? 1 : 0;
+	sample.magic = SOCK_MAGIC;
 
-	if (flag_debug) {
-		printf ("--- Split ---\n");
-		output_time (now);
+	if (sendto (out->sock_fd, &sample, sizeof (sample), 0, (struct sockaddr *) &out->sock_addr, sizeof (out->sock_addr)) != sizeof (sample)) {
+		if (flag_debug) printf ("can't send sample to '%s': %s\n", out->sock_addr.sun_path, strerror (errno));
 	}
+}
 
-	if (last->stamp == 0) {
 
-		if (last->min >= 0) {
-			now->min_chk = last->min_chk;
-			if (now->min >= 0) {
-				if (now->min == (last->min + 1) % 60) now->min_chk++;
-				else if (last->min_chk > 0) {
-					now->min = (last->min + 1) % 60;
-					now->min_chk--;
-				}
-			}
-			else now->min = (last->min + 1) % 60;
-		}
 
-		if (now->min == 0 && last->hour >= 0) last->hour = (last->hour + 1) % 24;
+// follow the offset of the filtered minute marker to the system clock over hours
+// only useful if the system clock is disciplined by other sources
+#define CALIBRATE_WEIGHT 256		// minutes
+#define CALIBRATE_LIMIT  200000000L	// ignore offsets of more then 200 msec
 
-		if (last->hour >= 0) {
-			now->hour_chk = last->hour_chk;
-			if (now->hour >= 0) {
-				if (now->hour == last->hour) now->hour_chk++;
-				else if (last->hour_chk > 0) {
-					now->hour = last->hour;
-					now->hour_chk--;
-				}
-			}
-			else now->hour = last->hour;
-		}
+void calibrate_delay (output_t *out, const dcf77_result *res) {
 
-		if (last->day > 0) {
-			now->day_chk = last->day_chk;
-			if (now->day > 0) {
-				if  (now->day == last->day) now->day_chk++;
-				else if (last->day_chk > 0) {
-					now->day = last->day;
-					now->day_chk--;
-				}
-			}
-			else now->day = last->day;
-		}
+	int64_t offset = (int64_t) (res->mark.clock.tv_sec - res->time.stamp) * 1000000000LL + res->mark.clock.tv_nsec;
 
-		if (last->wday > 0) {
-			now->wday_chk = last->wday_chk;
-			if (now->wday > 0) {
-				if (now->wday == last->wday) now->wday_chk++;
-				else if (last->wday_chk > 0) {
-					now->wday = last->wday;
-					now->wday_chk--;
-				}
-			}
-			else now->wday = last->wday;
-		}
+	if (offset < -CALIBRATE_LIMIT || offset > CALIBRATE_LIMIT) return;
 
-		if (last->mon > 0) {
-			now->mon_chk = last->mon_chk;
-			if (now->mon > 0) {
-				if  (now->mon == last->mon) now->mon_chk++;
-				else if (last->mon_chk > 0) {
-					now->mon = last->mon;
-					now->mon_chk--;
-				}
-			}
-			else now->mon = last->mon;
-		}
+	if (out->calibrated < CALIBRATE_WEIGHT) out->calibrated++;
+	out->delay += (offset - out->delay) / (int64_t) out->calibrated;
 
-		if (last->year >= 0) {
-			now->year_chk = last->year_chk;
-			if (now->year >= 0) {
-				if (now->year == last->year) now->year_chk++;
-				else if (last->year_chk > 0) {
-					now->year = last->year;
-					now->year_chk--;
-				}
-			}
-			else now->year = last->year;
-		}
+	if (flag_debug) printf ("Receiver Delay: %+12.6lf msec (offset %+12.6lf msec)\n", 0.000001 * out->delay, 0.000001 * offset);
+}
 
-		if (last->tz > 0) {
-			now->tz_chk = last->tz_chk;
-			if (now->tz > 0) {
-				if   (now->tz == last->tz) now->tz_chk++;
-				else if (last->tz_chk > 0) {
-					now->tz = last->tz;
-					now->tz_chk--;
-				}
-			}
-			else now->tz = last->tz;
-		}
 
-		if (now->min_chk > 1 && now->hour_chk > 1 && now->day_chk > 1 && now->wday_chk > 1 && now->mon_chk > 1 && now->year_chk > 1 && now->tz_chk > 1) {
-			dcf_time.tm_sec = 0;
-			dcf_time.tm_min = now->min;
-			dcf_time.tm_hour = now->hour;
-			dcf_time.tm_mday = now->day;
-			dcf_time.tm_mon = now->mon - 1;
-			dcf_time.tm_year = now->year + 100;
-			dcf_time.tm_wday = 0;
-			dcf_time.tm_yday = 0;
-			dcf_time.tm_isdst = now->tz - 1;
-			now->stamp = mktime (&dcf_time);
-			localtime_r (&now->stamp, &dcf_time);
-			if (dcf_time.tm_wday != now->wday % 7) now->stamp = 0;
-		}
-	}
-	else {
 
-		now->stamp = last->stamp + 60;
-		now->stamp_chk = last->stamp_chk;
-		localtime_r (&now->stamp, &dcf_time);
+// push one sample to the time daemons
+void publish_sample (output_t *out, const dcf77_result *res) {
 
-		if (now->min != dcf_time.tm_min) {
-			if (now->min >= 0) check++;
-			now->min = dcf_time.tm_min;
-		}
+	int64_t receive = res->mark.clock.tv_sec * 1000000000LL + res->mark.clock.tv_nsec - out->delay;
 
-		if (now->hour != dcf_time.tm_hour) {
-			if (now->hour >= 0) check++;
-			now->hour = dcf_time.tm_hour;
-		}
+	if (out->ntp_shm) set_ntp_shm (out->ntp_shm, res, out->delay);
+	if (out->sock_fd >= 0) set_chrony_sock (out, res);
+	event_put (out->log, EVENT_SAMPLE, res->mark.time.tv_sec * 1000000000LL + res->mark.time.tv_nsec, receive,
+		res->type == RESULT_SECOND ? res->second : 0, res->time.lsec > 0, res->time.stamp * 1000000000LL - receive);
+}
 
-		if (now->day != dcf_time.tm_mday) {
-			if (now->day > 0) check++;
-			now->day = dcf_time.tm_mday;
-		}
 
-		if (now->mon != dcf_time.tm_mon + 1) {
-			if (now->mon > 0) check++;
-			now->mon = dcf_time.tm_mon + 1;
-		}
 
-		if (now->year != dcf_time.tm_year - 100) {
-			if (now->year >= 0) check++;
-			now->year = dcf_time.tm_year - 100;
-		}
+void handle_result (output_t *out, const dcf77_result *res) {
 
-		if (now->wday % 7 != dcf_time.tm_wday) {
-			if (now->wday > 0) check++;
-			now->wday = dcf_time.tm_wday;
-			if (now->wday == 0) now->wday = 7;
-		}
+	struct timespec clock_set;
 
-		if (now->tz != dcf_time.tm_isdst + 1) {
-			if (now->tz >= 0) check++;
-			now->tz = last->tz;
-		}
+	if (res->type == RESULT_SECOND) {
+		if (res->time.stamp && out->synced) publish_sample (out, res);
+		return;
+	}
 
-		if (now->min == 1) {
-			last->dst = 0;
-			last->lsec = 0;
+// with '-D' the decoder has told it already
+	if (res->type == RESULT_RESYNC) {
+		if (out->replay && flag_debug == 0) {
+			if (out->name) printf ("%s: search for new minute start...\n", out->name);
+			else printf ("search for new minute start...\n");
 		}
+		return;
+	}
 
-		if (now->dst) {
-			last->dst += now->dst;
-		}
+	if (res->type == RESULT_DATA) {
+		if ((out->fifo_name[0] != '\0' || out->pub) && out->block_data.string[(res->time.min % 3) * 14] == '\0')
+			gather_data (&out->block_data, res->data, &res->time, out->fifo_name, out->pub);
+		return;
+	}
+	if (res->type != RESULT_MINUTE) return;
 
-		if (now->lsec) {
-			last->lsec += now->lsec;
-		}
+	if (res->first) init_dcf77_data (&out->block_data);
+
+// in replay one line per decoded minute: edge time, stamp, confirmation
+	if (out->replay && flag_debug == 0) {
+		if (out->name)
+			printf ("%s: %10ld.%09ld %10ld %2d\n", out->name, res->edge.clock.tv_sec, res->edge.clock.tv_nsec, res->time.stamp, res->time.stamp_chk);
+		else
+			printf ("%10ld.%09ld %10ld %2d\n", res->edge.clock.tv_sec, res->edge.clock.tv_nsec, res->time.stamp, res->time.stamp_chk);
+	}
 
-		if (check) now->stamp_chk--;
-		else now->stamp_chk++;
-
-		if (now->stamp_chk > 10) now->stamp_chk = 10;
-		if (now->stamp_chk < 0) {
-			now->min_chk = 1;
-			now->hour_chk = 1;
-			now->tz_chk = 1;
-			now->day_chk = 1;
-			now->mon_chk = 1;
-			now->wday_chk = 1;
-			now->year_chk = 1;
-			now->stamp = 0;
+	if (res->time.stamp) {
+		if ((res->edge.clock.tv_sec + 1200) < (res->time.stamp - res->time.tz * 3600)) {
+			if (flag_debug) printf ("Systemclock is more then 20 minutes off time. Set it hard!\n");
+			clock_set.tv_sec = res->time.stamp - (res->time.tz * 3600);
+			if (res->sig_avr < 0) {
+				clock_set.tv_sec--;
+				clock_set.tv_nsec = 1000000000L + res->sig_avr;
+			}
+			else {
+				clock_set.tv_nsec = res->sig_avr;
+			}
+//			clock_settime (CLOCK_REALTIME, &clock_set);
+			out->synced = 0;
+		}
+		else {
+			if (out->calibrate) calibrate_delay (out, res);
+			publish_sample (out, res);
+			out->synced = 1;
 		}
 	}
 }
 
 
 
-void init_dcf77_time (dcf77_time *time) {
-	time->min = -2;
-	time->min_chk = 0;
-	time->hour = -2;
-	time->hour_chk = 0;
-	time->day = -2;
-	time->day_chk = 0;
-	time->wday = -2;
-	time->wday_chk = 0;
-	time->mon = -2;
-	time->mon_chk = 0;
-	time->year = -2;
-	time->year_chk = 0;
-	time->tz = -2;
-	time->tz_chk = 0;
-	time->dst = -2;
-	time->check = -50;
-	time->lsec = 0;
-	time->alert = 0;
-	time->stamp = 0;
-	time->stamp_chk = 0;
-}
+// decode a trace with its own decoder, runs as thread if more then one trace is given
+void *replay_thread (void *arg) {
 
-void init_dcf77_data (dcf77_data *data) {
-	memset (data->string, '\0', 128);
-	data->block = 0;
-}
+	replay_t *rep = arg;
+	dcf77_decoder dec;
+	dcf77_stats stats;
+	dcf77_result res;
+	size_t pos, count;
 
-void init_time_info (time_info_t *info) {
-	info->time.tv_sec = 0;
-	info->time.tv_nsec = 0;
-	info->clock.tv_sec = 0;
-	info->clock.tv_nsec = 0;
+	decoder_init (&dec, rep->tolerance, flag_debug);
+	dec.seconds = rep->out.seconds;
+
+// the replay has no output thread, the text of '-D' is printed here before the results of its edges
+	for (pos = 0 ; pos < rep->count && flag_run ; pos += count) {
+		count = rep->count - pos < REPLAY_BATCH ? rep->count - pos : REPLAY_BATCH;
+		count = decoder_feed (&dec, &rep->edge[pos], count);
+		if (text_done (&dec.text)) {
+			fwrite (dec.text.buf, 1, dec.text.len, stdout);
+			dec.text.len = 0;
+		}
+		while (decoder_poll (&dec, &res)) handle_result (&rep->out, &res);
+	}
+
+	if (flag_debug) {
+		decoder_stats (&dec, &stats);
+		if (rep->out.name) printf ("Statistics of %s:\n", rep->out.name);
+		else printf ("Statistics:\n");
+		output_stats (&stats);
+	}
+
+	fflush (stdout);
+	return NULL;
 }
 
 
 
-void gather_data (dcf77_data *data, const int8_t *clock_data, const dcf77_time *time, const char *fifo_name) {
+// take the pulse statistics of a receiver, if requested by SIGUSR1
+// the next snapshot waits until the output has printed the last one
+void receiver_stats (receiver_t *rcv) {
 
-	int i, fifo;
+	if (rcv->stats_seen == stats_req) return;
+	if (__atomic_load_n (&rcv->stats_shown, __ATOMIC_ACQUIRE) != rcv->stats_done) return;
+	rcv->stats_seen = stats_req;
 
-	if (strlen(fifo_name) == 0) return;
-	if (time->stamp == 0 || time->tz < 0 || time->wday < 0) return;
+	decoder_stats (&rcv->dec, &rcv->stats);
+	__atomic_store_n (&rcv->stats_done, rcv->stats_done + 1, __ATOMIC_RELEASE);
+	edge_wakeup (output_event);
+}
 
-	data->block = time->min % 3;
-	if (data->block == 0) init_dcf77_data (data);
 
-	for (i = 0 ; i < 14 ; i++) data->string[data->block * 14 + i] = '0' + clock_data[i + 1];
 
-	if (data->block == 2) {
-		write_bcd (&data->string[42], time->min);
-		write_bcd (&data->string[50], time->hour);
-		write_bcd (&data->string[58], time->day);
-		write_bcd (&data->string[66], time->mon);
-		write_bcd (&data->string[71], time->wday);
-		write_bcd (&data->string[74], time->year);
-		data->string[82] = '+';
+// print what the decoder thread of a receiver has to tell, called by the output
+void receiver_report (receiver_t *rcv) {
 
-		if (time->tz > 0)
-			data->string[83] = '0' + time->tz;
-		else
-			data->string[83] = '0';
+	unsigned int done;
+	uint32_t lost, err;
+	int sig_lost;
 
-		data->string[84] = '\n';
-		data->string[85] = '\0';
+	done = __atomic_load_n (&rcv->stats_done, __ATOMIC_ACQUIRE);
+	if (done != rcv->stats_shown) {
+		printf ("Statistics of receiver %d:\n", rcv->index);
+		output_stats (&rcv->stats);
+		__atomic_store_n (&rcv->stats_shown, done, __ATOMIC_RELEASE);
 	}
 
-	if (flag_debug) {
-		for (i = 0 ; i < 82 ; i++) {
-			if (i == 14 || i == 28 || i == 42) printf (" ");
-			if (data->string[i] == '\0') printf ("_");
-			else printf ("%c", data->string[i]);
-		}
-		printf ("\n");
-		fflush (stdout);
+	sig_lost = __atomic_load_n (&rcv->sig_lost, __ATOMIC_RELAXED);
+	if (sig_lost != rcv->sig_shown) {
+		if (sig_lost && flag_debug) printf ("no edge on receiver %d for %d msec, signal lost?\n", rcv->index, SIGNAL_TIMEOUT);
+		rcv->sig_shown = sig_lost;
 	}
 
-	if (data->block == 2) {
-		if (data->string[0] && data->string[14] && data->string[28]) {
-			if ((fifo = open (fifo_name, O_WRONLY | O_NONBLOCK)) >= 0) {
-				write(fifo, data->string, strlen(data->string));
-				close (fifo);
-			}
-		}
-		data->string[0] = '\0';
+	lost = __atomic_load_n (&rcv->queue[0].lost, __ATOMIC_RELAXED) + __atomic_load_n (&rcv->queue[1].lost, __ATOMIC_RELAXED);
+	if (lost != rcv->lost_last) {
+		if (flag_debug) printf ("edge queue %d overflow, %u edges lost\n", rcv->index, lost - rcv->lost_last);
+		rcv->lost_last = lost;
+	}
+
+	err = __atomic_load_n (&rcv->trace_err, __ATOMIC_ACQUIRE);
+	if (err != rcv->trace_err_last) {
+		if (flag_debug) printf ("can't write trace: %s (%u times)\n", strerror (__atomic_load_n (&rcv->trace_errno, __ATOMIC_RELAXED)), err - rcv->trace_err_last);
+		rcv->trace_err_last = err;
+	}
+
+	lost = __atomic_load_n (&rcv->text.lost, __ATOMIC_RELAXED);
+	if (lost != rcv->text_lost_last) {
+		if (flag_debug) printf ("text queue %d overflow, %u texts lost\n", rcv->index, lost - rcv->text_lost_last);
+		rcv->text_lost_last = lost;
 	}
 }
 
 
 
-static volatile struct shmTime *getShmTime (int unit) {
+// keep what the decoder of a receiver has learned, after every minute
+void receiver_save (receiver_t *rcv, const dcf77_result *res) {
+	if (state && res->type == RESULT_MINUTE) decoder_save (&rcv->dec, &state->prior[rcv->index]);
+}
 
-	int shmid;
-	volatile struct shmTime *ntp_shm;
 
-	shmid = shmget (NTPD_BASE + unit, sizeof (struct shmTime), IPC_CREAT | 0777);
-	if (shmid == -1) return NULL;
 
-	ntp_shm = (struct shmTime *) shmat (shmid, NULL, 0);
-	if (ntp_shm == (void *) -1) return NULL;
+// publish the counters of a receiver after every batch of edges
+void receiver_metrics (receiver_t *rcv) {
+	if (metrics) metrics_update (&metrics->rcv[rcv->index], &rcv->dec);
+}
 
-	ntp_shm->valid = 0;
-	ntp_shm->mode = 1;
-	ntp_shm->count = 0;
 
-	return ntp_shm;
 
+// called by a source that is not live after its last edge
+static void source_done (const edge_source *src) {
+
+	receiver_t *rcv = src->sink_arg;
+
+	__atomic_store_n (&rcv->src_done, 1, __ATOMIC_RELEASE);
+	edge_wakeup (rcv->event);
 }
 
 
 
-void set_ntp_shm (volatile struct shmTime *ntp_shm, const dcf77_time *now, const long min_dev, const long sig_avr) {
+// decode the edges of one receiver, the results are handed over to the output in the main thread,
+// with more receivers only the frames to the fusion
+// when the source has ended and its edges are decoded the thread ends, with the last one the daemon
+void *receiver_thread (void *arg) {
 
-	static int precision = 5 * 16;
+	receiver_t *rcv = arg;
+	static edge_t edge_batch[RECEIVER_MAX][2 * EDGE_QUEUE_SIZE];
+	dcf77_result res;
+	size_t edge_cnt, pos, count;
+	int done;
 
-	int prec;
-	long tmp = min_dev < 0 ? -min_dev : min_dev;
+	while (flag_run) {
+
+		receiver_stats (rcv);
 
-	if      (tmp <       950) prec = 20 * 16;
-	else if (tmp <      1900) prec = 19 * 16;
-	else if (tmp <      3800) prec = 18 * 16;
-	else if (tmp <      7625) prec = 17 * 16;
-	else if (tmp <     15250) prec = 16 * 16;
-	else if (tmp <     30500) prec = 15 * 16;
-	else if (tmp <     61025) prec = 14 * 16;
-	else if (tmp <    122050) prec = 13 * 16;
-	else if (tmp <    244125) prec = 12 * 16;
-	else if (tmp <    488250) prec = 11 * 16;
-	else if (tmp <    976500) prec = 10 * 16;
-	else if (tmp <   1953125) prec =  9 * 16;
-	else if (tmp <   3906250) prec =  8 * 16;
-	else if (tmp <   7812500) prec =  7 * 16;
-	else if (tmp <  15625000) prec =  6 * 16;
-	else                      prec =  5 * 16;
+// sleep until the source signals new edges
+		done = __atomic_load_n (&rcv->src_done, __ATOMIC_ACQUIRE);
+		edge_cnt = get_edges (rcv, edge_batch[rcv->index]);
+		if (edge_cnt == 0) {
+			if (done) {
+				if (__atomic_add_fetch (&receiver_end, 1, __ATOMIC_ACQ_REL) == receiver_cnt) quit (0);
+				break;
+			}
+			if (edge_wait (rcv->event, SIGNAL_TIMEOUT) == 0 && rcv->sig_lost == 0) {
+				__atomic_store_n (&rcv->sig_lost, 1, __ATOMIC_RELAXED);
+				edge_wakeup (output_event);
+			}
+			continue;
+		}
+		if (rcv->sig_lost) __atomic_store_n (&rcv->sig_lost, 0, __ATOMIC_RELAXED);
 
-	if (prec > precision) precision++;
-	if (prec < precision) precision -= 2;
+		if (trace_write (trace_fd, edge_batch[rcv->index], edge_cnt) < 0) {
+			__atomic_store_n (&rcv->trace_errno, errno, __ATOMIC_RELAXED);
+			__atomic_store_n (&rcv->trace_err, rcv->trace_err + 1, __ATOMIC_RELEASE);
+		}
 
-	if (flag_debug) {
-		printf ("Prec_now : %d\n", prec);
-		printf ("Precision: %d (%d)\n", precision, -(precision >> 4));
+// the text of '-D' goes to the output ahead of the results of its edges
+		for (pos = 0 ; pos < edge_cnt ; pos += count) {
+			count = decoder_feed (&rcv->dec, &edge_batch[rcv->index][pos], edge_cnt - pos);
+			if (text_done (&rcv->dec.text)) {
+				text_queue_push (&rcv->text, rcv->dec.text.buf, rcv->dec.text.len);
+				rcv->dec.text.len = 0;
+				edge_wakeup (output_event);
+			}
+			while (decoder_poll (&rcv->dec, &res)) {
+				receiver_save (rcv, &res);
+				if (receiver_cnt == 1) {
+					result_queue_push (&rcv->results, &res);
+					edge_wakeup (output_event);
+					continue;
+				}
+				if (res.type != RESULT_FRAME && res.type != RESULT_SECOND) continue;
+				pthread_mutex_lock (&fusion_lock);
+				if (res.type == RESULT_FRAME) fusion_frame (&fusion, rcv->index, &res);
+				else fusion_second (&fusion, rcv->index, &res);
+				pthread_mutex_unlock (&fusion_lock);
+				edge_wakeup (output_event);
+			}
+		}
+		receiver_metrics (rcv);
 	}
 
-	ntp_shm->valid = 0;
+	return NULL;
+}
 
-	ntp_shm->clockTimeStampSec = now->stamp;
-	ntp_shm->clockTimeStampUSec = 0;
 
-/*
-	if (sig_avr < 0L) {
-		ntp_shm->clockTimeStampUSec = (-sig_avr) / 1000;
-	}
-	else
-		ntp_shm->clockTimeStampSec--;
-		ntp_shm->clockTimeStampUSec = 1000000 - (sig_avr / 1000);
-*/
 
-	ntp_shm->receiveTimeStampSec = sig_now.clock.tv_sec;
-	ntp_shm->receiveTimeStampUSec = sig_now.clock.tv_nsec / 1000;
+// publish the results of a single receiver, a slow FIFO or socket only holds up the output
+// the results pushed before the stop are still published
+void output_loop (output_t *out, receiver_t *rcv) {
 
-/*
-	if (min_dev < 0) {
-		ntp_shm->receiveTimeStampUSec += (tmp / 1000);
-		if (ntp_shm->receiveTimeStampUSec > 1000000) {
-			ntp_shm->receiveTimeStampSec++;
-			ntp_shm->receiveTimeStampUSec -= 1000000;
-		}
-	}
-	else {
-		if (ntp_shm->receiveTimeStampUSec < (tmp / 1000)) {
-			ntp_shm->receiveTimeStampSec--;
-			ntp_shm->receiveTimeStampUSec += 1000000;
+	dcf77_result res;
+	uint32_t lost, lost_last = 0;
+	int stop;
+
+	do {
+		stop = __atomic_load_n (&flag_run, __ATOMIC_ACQUIRE) == 0;
+		text_queue_print (&rcv->text, stdout);
+		while (result_queue_pop (&rcv->results, &res)) handle_result (out, &res);
+		receiver_report (rcv);
+
+		lost = __atomic_load_n (&rcv->results.lost, __ATOMIC_RELAXED);
+		if (lost != lost_last) {
+			if (flag_debug) printf ("result queue overflow, %u results lost\n", lost - lost_last);
+			lost_last = lost;
 		}
-		ntp_shm->receiveTimeStampUSec -= (tmp / 1000);
-	}
-*/
+		fflush (stdout);
 
-	ntp_shm->precision = -(precision >> 4);
+		if (stop == 0) edge_wait (output_event, SIGNAL_TIMEOUT);
+	} while (stop == 0);
+}
 
-	if (now->lsec > 0)
-		ntp_shm->leap = LEAP_ADDSECOND;
-	else
-		ntp_shm->leap = LEAP_NOWARNING;
 
-	ntp_shm->count++;
-	ntp_shm->valid = 1;
+
+// publish the fused minutes, also when a receiver did not deliver its frame in time
+void fusion_loop (output_t *out) {
+
+	static char text[DECODER_TEXT];
+	struct timespec ts;
+	dcf77_result res;
+	int64_t now, deadline;
+	int timeout, got, i, stop;
+	size_t len;
+
+	do {
+		stop = __atomic_load_n (&flag_run, __ATOMIC_ACQUIRE) == 0;
+
+		clock_gettime (CLOCK_MONOTONIC_RAW, &ts);
+		now = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+
+		for (i = 0 ; i < receiver_cnt ; i++) text_queue_print (&receiver[i].text, stdout);
+
+// at the stop a minute is published without the receivers still missing
+// the text of the fusion is copied, stdout must not hold up the receivers
+		pthread_mutex_lock (&fusion_lock);
+		fusion_timeout (&fusion, stop ? now + FUSION_WAIT : now);
+		deadline = fusion_deadline (&fusion);
+		len = text_done (&fusion.text);
+		memcpy (text, fusion.text.buf, len);
+		fusion.text.len = 0;
+		pthread_mutex_unlock (&fusion_lock);
+		fwrite (text, 1, len, stdout);
+
+		do {
+			pthread_mutex_lock (&fusion_lock);
+			got = fusion_poll (&fusion, &res);
+			pthread_mutex_unlock (&fusion_lock);
+			if (got) handle_result (out, &res);
+		} while (got);
+		for (i = 0 ; i < receiver_cnt ; i++) receiver_report (&receiver[i]);
+		fflush (stdout);
+
+		timeout = SIGNAL_TIMEOUT;
+		if (deadline && (deadline - now) / 1000000 + 1 < timeout) timeout = (deadline - now) / 1000000 + 1;
+		if (timeout < 1) timeout = 1;
+		if (stop == 0) edge_wait (output_event, timeout);
+	} while (stop == 0);
 }
 
 
@@ -858,27 +956,53 @@ static void start_daemon (void) {
 int main (int argc, char *argv[])
 {
 
-	time_info_t min_last, sec_last, sig_last;
-	struct timespec diff;
-	int sec_cnt = 0, min_cnt = 0, edge_dir = 0, unit = -1, gpio[2] = {-1, -1}, sig_cnt = 0, noise, i, j;
-	int8_t data[60];
-	long min_dev = 0, tolerance = 25000000L, sig_stat[60], sig_avr;
-	char fifo_name[256] = "";
+	receiver_t *rcv;
+	output_t out;
+	int unit = -1, i;
+	static replay_t replay[REPLAY_MAX];
+	int replay_cnt = 0;
+	char *next;
+	long tolerance = 25000000L;
+	int64_t delay = 0;
+	unsigned long debounce = 0;
+	int calibrate = 0, seconds = 0, rt_prio = 0, rt_cpu = -1;
+	char fifo_name[256] = "", trace_name[256] = "", sock_name[256] = "", state_name[256] = "", metrics_name[256] = "", event_name[256] = "", publish_name[256] = "";
+	struct timespec now;
+	const char *source_arg = NULL;
+	const source_ops *source = source_default ();
 	static volatile struct shmTime *ntp_shm = NULL;
 
-	unsigned int sig_short = 0, sig_long = 0;
-
-	while ((i = getopt (argc, argv, "g:Dhu:f:t:")) != -1) {
+	while ((i = getopt (argc, argv, "g:Dhu:s:pf:F:t:r:w:d:cS:b:R:k:m:e:")) != -1) {
 		switch (i) {
 
 			case 'h':
-				fprintf (stderr, "Usage: %s [-h] [-D] -g <pin> [-g <pin>] [-u <num>] [-f <name>] [-t <msec>]\n", argv[0]);
+				fprintf (stderr, "Usage: %s [-h] [-D] -g <pin>[,<pin>] [-g ...] [-u <num>] [-s <socket>] [-p] [-f <name>] [-F <socket>] [-t <msec>] [-d <msec>] [-c] [-S <source>] [-b <usec>] [-R <prio>[,<cpu>]] [-k <file>] [-m <file>] [-e <log>] [-w <trace>]\n", argv[0]);
+				fprintf (stderr, "       %s [-h] [-D] -r <trace> [-r <trace> ...] [-u <num>] [-s <socket>] [-p] [-f <name>] [-t <msec>]\n", argv[0]);
 				fprintf (stderr, "    -h          this helptext\n");
 				fprintf (stderr, "    -D          debbuging (don't fork to background)\n");
-				fprintf (stderr, "    -g <pin>    GPIO-pin (or pins) that is connection to the receiver\n");
+				fprintf (stderr, "    -g <pin>    GPIO-pin that is connected to a receiver, 'pin,pin' for a receiver\n");
+				fprintf (stderr, "                with inverted output on the second pin (up to %d receivers)\n", RECEIVER_MAX);
+				fprintf (stderr, "    -S <source> where the edges come from, one of:\n");
+				source_usage ();
+				fprintf (stderr, "    -b <usec>   debounce period of the GPIO lines, if the source supports it (default: 0, off)\n");
+				fprintf (stderr, "    -R <prio>   capture the edges with SCHED_FIFO priority <prio> (1 to 99) and locked memory,\n");
+				fprintf (stderr, "                ',<cpu>' pins the capture to this CPU (default: off)\n");
 				fprintf (stderr, "    -u <num>    unit-number of NTP shared memory driver\n");
+				fprintf (stderr, "    -s <socket> SOCK refclock of chrony to send the samples to\n");
+				fprintf (stderr, "    -p          push a sample on every second mark, not only once per minute\n");
 				fprintf (stderr, "    -f <name>   fifoname to send additional data (bit 1 to 14)\n");
+				fprintf (stderr, "    -F <socket> UNIX socket for any number of clients of the additional data,\n");
+				fprintf (stderr, "                with the blocks of the last hour for a client that connects\n");
 				fprintf (stderr, "    -t <msec>   tolerance in milliseconds (default: 25)\n");
+				fprintf (stderr, "    -d <msec>   delay of the receiver in milliseconds (default: 0)\n");
+				fprintf (stderr, "    -c          calibrate the delay against the system clock, needs other NTP sources\n");
+				fprintf (stderr, "    -k <file>   keep the state of the decoders in this file, for a fast start after a restart\n");
+				fprintf (stderr, "    -m <file>   write the counters of the receivers to this file for 'dcf77_export', e.g. on /dev/shm\n");
+				fprintf (stderr, "    -e <log>    binary event log to a file or 'unix:<socket>', see 'dcf77_render',\n");
+				fprintf (stderr, "                replaces the per edge output of '-D'\n");
+				fprintf (stderr, "    -w <trace>  record all edges to a trace file\n");
+				fprintf (stderr, "    -r <trace>  replay a trace file as fast as possible instead of GPIO\n");
+				fprintf (stderr, "                (more traces are replayed in parallel)\n");
 				return EXIT_FAILURE;
 
 			case 'D':
@@ -886,23 +1010,92 @@ int main (int argc, char *argv[])
 				break;
 
 			case 'g':
-				if (gpio[0] >= 0) {
-					if (gpio[1] >= 0) gpio[0] = gpio[1];
-					gpio[1] = atoi (optarg);
-				}
-				else {
-					gpio[0] = atoi (optarg);
+				if (receiver_cnt >= RECEIVER_MAX) {
+					fprintf (stderr, "Too many receivers, ignore '%s'!\n", optarg);
+					break;
 				}
+				rcv = &receiver[receiver_cnt];
+				rcv->index = receiver_cnt;
+				rcv->event = -1;
+				rcv->pin[0] = strtol (optarg, &next, 10);
+				rcv->pin[1] = *next == ',' ? atoi (next + 1) : -1;
+				receiver_cnt++;
 				break;
 
 			case 'u':
 				unit = atoi (optarg);
 				break;
 
+			case 's':
+				strncpy (sock_name, optarg, 255);
+				break;
+
+			case 'p':
+				seconds = 1;
+				break;
+
 			case 'f':
 				strncpy (fifo_name, optarg, 255);
 				break;
 
+			case 'F':
+				strncpy (publish_name, optarg, 255);
+				break;
+
+			case 'k':
+				strncpy (state_name, optarg, 255);
+				break;
+
+			case 'm':
+				strncpy (metrics_name, optarg, 255);
+				break;
+
+			case 'e':
+				strncpy (event_name, optarg, 255);
+				break;
+
+			case 'w':
+				strncpy (trace_name, optarg, 255);
+				break;
+
+			case 'r':
+				if (replay_cnt >= REPLAY_MAX) {
+					fprintf (stderr, "Too many traces, ignore '%s'!\n", optarg);
+					break;
+				}
+				replay[replay_cnt].out.name = optarg;
+				replay_cnt++;
+				break;
+
+			case 'd':
+				delay = strtod (optarg, NULL) * 1000000.0;
+				break;
+
+			case 'c':
+				calibrate = 1;
+				break;
+
+			case 'S':
+				if ((source = source_find (optarg, &source_arg)) == NULL) {
+					fprintf (stderr, "Unknown source '%s'! exit.\n", optarg);
+					fprintf (stderr, "See '%s -h' for the sources compiled in.\n", argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 'b':
+				debounce = strtoul (optarg, NULL, 10);
+				break;
+
+			case 'R':
+				rt_prio = strtol (optarg, &next, 10);
+				rt_cpu = *next == ',' ? atoi (next + 1) : -1;
+				if (rt_prio < 1 || rt_prio > 99) {
+					fprintf (stderr, "Priority must be 1 to 99! exit.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+
 			case 't':
 				tolerance = strtol (optarg, NULL, 10);
 				if (tolerance < 5) {
@@ -924,19 +1117,94 @@ int main (int argc, char *argv[])
 		}
 	}
 
-	if (gpio[0] < 0) {
-		fprintf (stderr, "no GPIO-pin given! exit.\n");
-		return EXIT_FAILURE;
+// replay a trace instead of the GPIO, in foreground and without a source
+	if (replay_cnt) {
+		for (i = 0 ; i < replay_cnt ; i++) {
+			if ((replay[i].edge = trace_map (replay[i].out.name, &replay[i].count)) == NULL) {
+				fprintf (stderr, "Can't read trace '%s'! exit.\n", replay[i].out.name);
+				return EXIT_FAILURE;
+			}
+		}
+		if (replay_cnt > 1 && (unit >= 0 || sock_name[0] != '\0')) {
+			fprintf (stderr, "Only one trace can be replayed to NTP shared memory or chrony! exit.\n");
+			return EXIT_FAILURE;
+		}
 	}
 
-	wiringPiSetup();
+	else {
+		if (source == NULL) {
+			fprintf (stderr, "no GPIO source compiled in, give one with '-S'! exit.\n");
+			return EXIT_FAILURE;
+		}
+		if (source->pins == 0) {
+			if (receiver_cnt > 1) {
+				fprintf (stderr, "Source '%s' can only feed one receiver! exit.\n", source->name);
+				return EXIT_FAILURE;
+			}
+			if (receiver_cnt == 0) {
+				receiver[0].pin[0] = receiver[0].pin[1] = -1;
+				receiver_cnt = 1;
+			}
+		}
+		if (receiver_cnt == 0) {
+			fprintf (stderr, "no GPIO-pin given! exit.\n");
+			return EXIT_FAILURE;
+		}
+		if (receiver_cnt > 1 && trace_name[0] != '\0') {
+			fprintf (stderr, "Only one receiver can be recorded to a trace! exit.\n");
+			return EXIT_FAILURE;
+		}
 
 // fork to background
-	if (flag_debug == 0) start_daemon();
+		if (flag_debug == 0) start_daemon();
+
+		for (i = 0 ; i < receiver_cnt ; i++) {
+			if ((receiver[i].event = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+				fprintf (stderr, "Can't create eventfd! exit.\n");
+				return EXIT_FAILURE;
+			}
+		}
+		if ((output_event = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+			fprintf (stderr, "Can't create eventfd! exit.\n");
+			return EXIT_FAILURE;
+		}
+
+		if (state_name[0] != '\0' && (state = state_map (state_name)) == NULL) {
+			fprintf (stderr, "Can't map state file '%s'! exit.\n", state_name);
+			return EXIT_FAILURE;
+		}
+
+		if (metrics_name[0] != '\0' && (metrics = metrics_map (metrics_name, 1)) == NULL) {
+			fprintf (stderr, "Can't map metrics file '%s'! exit.\n", metrics_name);
+			return EXIT_FAILURE;
+		}
+
+		if (event_name[0] != '\0') {
+			if (event_open (&events, event_name) < 0) {
+				fprintf (stderr, "Can't open event log '%s'! exit.\n", event_name);
+				return EXIT_FAILURE;
+			}
+			events_on = 1;
+		}
+
+		if (publish_name[0] != '\0') {
+			if (publish_open (&publisher, publish_name, flag_debug) < 0) {
+				fprintf (stderr, "Can't listen on '%s'! exit.\n", publish_name);
+				return EXIT_FAILURE;
+			}
+			publisher_on = 1;
+		}
+
+		if (trace_name[0] != '\0' && (trace_fd = trace_open (trace_name)) < 0) {
+			fprintf (stderr, "Can't open trace '%s'! exit.\n", trace_name);
+			return EXIT_FAILURE;
+		}
+	}
 
 	signal (SIGINT, quit);
 	signal (SIGQUIT, quit);
 	signal (SIGTERM, quit);
+	signal (SIGUSR1, stats_signal);
 
 	if (unit >= 0) {
 		if  ((ntp_shm = getShmTime(unit)) == NULL) {
@@ -945,313 +1213,113 @@ int main (int argc, char *argv[])
 		}
 	}
 
-	setenv("TZ", ":Europe/Berlin", 1);
-
-	dcf77_time time_last, time_now;
-	init_dcf77_time (&time_last);
-	init_dcf77_time (&time_now);
-
-	dcf77_data block_data;
-	init_dcf77_data (&block_data);
-
-	for (i = 0 ; i < 60 ; i++) data[i] = -1;
-	for (i = 0 ; i < 60 ; i++) sig_stat[i] = 0;
-
-	init_time_info (&sig_now);
-	init_time_info (&sig_last);
-	init_time_info (&sec_last);
-	init_time_info (&min_last);
-
-	pinMode(gpio[0], INPUT);
-	pullUpDnControl(gpio[0], PUD_UP);
-
-	if (gpio[1] >= 0) {
-		pinMode(gpio[1], INPUT);
-		pullUpDnControl(gpio[1], PUD_UP);
-		wiringPiISR(gpio[0], INT_EDGE_RISING, &edge_sig);
-		wiringPiISR(gpio[1], INT_EDGE_RISING, &edge_sig);
-	}
-	else {
-		wiringPiISR(gpio[0], INT_EDGE_BOTH, &edge_sig);
+	memset (&out, 0, sizeof (out));
+	out.ntp_shm = ntp_shm;
+	out.sock_fd = -1;
+	if (sock_name[0] != '\0' && (out.sock_fd = getChronySock (sock_name, &out.sock_addr)) < 0) {
+		fprintf (stderr, "Can't create socket for '%s'!\n", sock_name);
+		return EXIT_FAILURE;
 	}
+	out.delay = delay;
+	out.calibrate = calibrate;
+	out.seconds = seconds;
+	strncpy (out.fifo_name, fifo_name, sizeof (out.fifo_name) - 1);
+	if (publisher_on) out.pub = &publisher;
+	init_dcf77_data (&out.block_data);
+
+// every trace gets its own decoder and output, the name is only shown with more traces
+	if (replay_cnt) {
+		for (i = 0 ; i < replay_cnt ; i++) {
+			const char *name = replay[i].out.name;
+			replay[i].out = out;
+			replay[i].out.name = replay_cnt > 1 ? name : NULL;
+			replay[i].out.replay = 1;
+			replay[i].tolerance = tolerance;
+		}
 
-	while (flag_run) {
-
-		if (sig_now.time.tv_nsec != sig_last.time.tv_nsec || sig_now.time.tv_sec != sig_last.time.tv_sec) {
-
-			if (edge_dir != 0) {
-
-				get_diff (&diff, &sec_last, &sig_now, tolerance);
-
-
-
-
-
-// check for second marker
-				if (diff.tv_sec && check_tolerance (&diff, diff.tv_sec, 0L, tolerance)) {
-
-// store data
-					if (sig_short && sig_long == 0) data[sec_cnt] = 0;
-					if (sig_short == 0 && sig_long) data[sec_cnt] = 1;
-					if (sig_short && sig_long && sig_short < sig_long) data[sec_cnt] = 0;
-					if (sig_short && sig_long && sig_short > sig_long) data[sec_cnt] = 1;
-					sig_short = 0;
-					sig_long = 0;
-
-// calculate starting second
-					if (min_last.time.tv_sec)
-						sec_cnt = get_second (&diff, &min_last, &sig_now, tolerance);
-					else
-						sec_cnt += diff.tv_sec;
-
-// check more then a minute
-					if (sec_cnt > 59 && diff.tv_sec != 2) {
-						min_cnt++;
-						for (i = 0 ; i < 60 ; i++) data[i] = -1;
-
-						if (min_cnt > 2) {
-							printf ("search for new minute start...\n");
-							init_time_info (&min_last);
-							init_dcf77_time (&time_last);
-							min_cnt = 0;
-						}
-						else {
-							add_minute (&time_last, &min_last, sec_cnt / 60);
-						}
-						sec_cnt -= (sec_cnt / 60) * 60;
-					}
-
-//					memcpy (&sec_last, &sig_now, sizeof(sig_now));
-					sec_last.time.tv_sec++;
-					sec_last.clock.tv_sec++;
-
-					if (flag_debug) {
-						long signal = diff.tv_nsec - tolerance;
-						if (signal < 0) signal = -signal;
-						signal = (tolerance - signal) / (tolerance / 100);
-						printf ("= -> Dev: %+12.6lf msec / Signal: %ld%%\n", 0.000001 * (diff.tv_nsec - tolerance), signal);
-						if (min_last.time.tv_sec)
-							printf ("Sec: %02d\n", sec_cnt);
-						else
-							printf ("Sec: --\n");
-					}
-
-// gather data
-					if (sec_cnt > 14 && fifo_name[0] != '\0' && time_last.stamp && block_data.string[(time_last.min % 3) * 14] == '\0')
-						gather_data (&block_data, data, &time_last, fifo_name);
-
-// check for minute marker
-					if (min_last.time.tv_sec == 0 && diff.tv_sec == 2) {
-						memcpy (&min_last, &sig_now, sizeof(sig_now));
-						min_last.time.tv_sec -= 60;
-						min_last.clock.tv_sec -= 60;
-						if (sec_cnt < 59) {
-							for (i = 58 ; i >= 0 && data[i] == -1 ; i--);
-							for (j = 58 ; i >= 0 ; j--, i--) data[j] = data[i];
-							for (; j >= 0 ; j--) data[j] = -1;
-						}
-					}
-
-// check minute
-					if (min_last.time.tv_sec && diff.tv_sec == 2) {
-						get_diff (&diff, &min_last, &sig_now, tolerance);
-						if (diff.tv_sec == 60) {
-
-							if (flag_debug) {
-								printf("Minute-Data:\n");
-								for (i = 0 ; i < 60 ; i++) {
-									if ((i % 10) == 0) printf("%02d: ", i);
-									printf("%2d ", data[i]);
-									if ((i % 10) == 9) printf("\n");
-									else printf(" ");
-								}
-								printf ("--- Last ---\n");
-								output_time (&time_last);
-							}
-
-							min_dev = ((min_dev * 15) + (diff.tv_nsec - tolerance)) / 16;
-							check_data (data, &time_now, &time_last);
-							for (i = 0 ; i < 60 ; i++) data[i] = -1;
-
-							if (flag_debug) {
-								printf ("--- Now ---\n");
-								output_time (&time_now);
-								printf ("Average Minute Deviation: %+12.6lf msec\n", 0.000001 * min_dev);
-								printf ("Average Signal Deviation: %+12.6lf msec\n", 0.000001 * sig_avr);
-								printf("Minute Start Stamp: %10ld.%09ld\n", sig_now.time.tv_sec, sig_now.time.tv_nsec);
-								printf ("Sec: 00\n");
-							}
-
-							if (time_last.stamp == 0 && time_now.stamp) init_dcf77_data (&block_data);
-
-							memcpy (&time_last, &time_now, sizeof(time_now));
-							memcpy (&min_last, &sig_now, sizeof(sig_now));
-							memcpy (&sec_last, &sig_now, sizeof(sig_now));
-							min_cnt = 0;
-							sec_cnt = 0;
-
-							if (time_now.stamp) {
-								if ((sig_now.clock.tv_sec + 1200) < (time_now.stamp - time_now.tz * 3600)) {
-									if (flag_debug) printf ("Systemclock is more then 20 minutes off time. Set it hard!\n");
-									sig_now.clock.tv_sec = time_now.stamp - (time_now.tz * 3600);
-									if (sig_avr < 0) {
-										sig_now.clock.tv_sec--;
-										sig_now.clock.tv_nsec = 1000000000L + sig_avr;
-									}
-									else {
-										sig_now.clock.tv_nsec = sig_avr;
-									}
-//									clock_settime (CLOCK_REALTIME, &sig_now.clock);
-								}
-								else if (ntp_shm) {
-									set_ntp_shm (ntp_shm, &time_now, min_dev, sig_avr);
-								}
-							}
-
-							init_dcf77_time (&time_now);
-						}
-					}
-
-					noise--;
-				}
+		if (replay_cnt == 1) {
+			replay_thread (&replay[0]);
+		}
+		else {
+			for (i = 0 ; i < replay_cnt ; i++) {
+				if (pthread_create (&replay[i].thread, NULL, replay_thread, &replay[i]) == 0) replay[i].running = 1;
+				else replay_thread (&replay[i]);
+			}
+			for (i = 0 ; i < replay_cnt ; i++) {
+				if (replay[i].running) pthread_join (replay[i].thread, NULL);
+			}
+		}
 
+		if (ntp_shm) shmdt ((void *) ntp_shm);
+		return 0;
+	}
 
-// short signal == binary 0
-				else if (check_tolerance (&diff, 0, 100000000L + sig_avr, tolerance)) {
-					sig_short++;
-					sig_stat[sig_cnt] = diff.tv_nsec - tolerance - 100000000L;
-					sig_avr = 0;
-					for (i = 0 ; i < 60 ; i++) sig_avr += sig_stat[i];
-					sig_avr /= 60;
-
-					if (flag_debug) {
-						long signal = sig_stat[sig_cnt] - sig_avr;
-						if (signal < 0) signal = -signal;
-						signal = (tolerance - signal) / (tolerance / 100);
-						printf ("0 -> Dev: %+12.6lf msec / Signal: %ld%%\n", 0.000001 * ((diff.tv_nsec - tolerance - 100000000L) - sig_avr), signal);
-					}
-
-					sig_cnt++;
-					if (sig_cnt >= 60) sig_cnt = 0;
-					noise--;
-				}
+// the capture must never wait for a page, before the first thread is started
+	if (rt_prio && source_lock () < 0) fprintf (stderr, "Can't lock the memory: %s\n", strerror (errno));
+
+	for (i = 0 ; i < receiver_cnt ; i++) {
+		rcv = &receiver[i];
+		decoder_init (&rcv->dec, tolerance, flag_debug && events_on == 0);
+		if (events_on) rcv->dec.log = event_ring_add (&events, i);
+		rcv->dec.frames = receiver_cnt > 1;
+		rcv->dec.seconds = out.seconds;
+		if (state) {
+			clock_gettime (CLOCK_REALTIME, &now);
+			decoder_prior (&rcv->dec, &state->prior[i], now.tv_sec * 1000000000LL + now.tv_nsec);
+		}
 
-// long signal == binary 1
-				else if (check_tolerance (&diff, 0, 200000000L + sig_avr, tolerance)) {
-					sig_long++;
-					sig_stat[sig_cnt] = diff.tv_nsec - tolerance - 200000000L;
-					sig_avr = 0;
-					for (i = 0 ; i < 60 ; i++) sig_avr += sig_stat[i];
-					sig_avr /= 60;
-
-					if (flag_debug) {
-						long signal = sig_stat[sig_cnt] - sig_avr;
-						if (signal < 0) signal = -signal;
-						signal = (tolerance - signal) / (tolerance / 100);
-						printf ("1 -> Dev: %+12.6lf msec / Signal: %ld%%\n", 0.000001 * ((diff.tv_nsec - tolerance - 200000000L) - sig_avr), signal);
-					}
-
-					sig_cnt++;
-					if (sig_cnt >= 60) sig_cnt = 0;
-					noise--;
-				}
+		rcv->src.ops = source;
+		rcv->src.arg = source_arg;
+		rcv->src.pin[0] = rcv->pin[0];
+		rcv->src.pin[1] = rcv->pin[1];
+		rcv->src.debounce = debounce;
+		rcv->src.index = i;
+		rcv->src.debug = flag_debug;
+		rcv->src.rt_prio = rt_prio;
+		rcv->src.cpu = rt_cpu;
+		rcv->src.setup = source_realtime;
+		rcv->src.done = source_done;
+		rcv->src.sink = edge_push;
+		rcv->src.sink_arg = rcv;
+		if (source->start (&rcv->src) < 0) {
+			fprintf (stderr, "Can't start source '%s' of receiver %d! exit.\n", source->name, i);
+			return EXIT_FAILURE;
+		}
+		decoder_limit (&rcv->dec, rcv->src.precision);
+	}
 
-// noise
-				else {
-					if (diff.tv_sec) {
-// store data
-						if (sig_short && sig_long == 0) data[sec_cnt] = 0;
-						if (sig_short == 0 && sig_long) data[sec_cnt] = 1;
-						if (sig_short && sig_long && sig_short < sig_long) data[sec_cnt] = 0;
-						if (sig_short && sig_long && sig_short > sig_long) data[sec_cnt] = 1;
-						sig_short = 0;
-						sig_long = 0;
-
-						sec_last.time.tv_sec += diff.tv_sec;
-						sec_last.clock.tv_sec += diff.tv_sec;
-						sec_cnt += diff.tv_sec;
-
-						if (sec_cnt > 59) {
-							min_cnt++;
-							for (i = 0 ; i < 60 ; i++) data[i] = -1;
-
-							if (min_cnt > 2) {
-								printf ("search for new minute start...\n");
-								init_time_info (&min_last);
-								init_dcf77_time (&time_last);
-								min_cnt = 0;
-							}
-							else {
-								add_minute (&time_last, &min_last, sec_cnt / 60);
-							}
-							sec_cnt -= (sec_cnt / 60) * 60;
-						}
-						if (flag_debug) {
-							if (min_last.time.tv_sec) printf ("Sec: %02d ?\n", sec_cnt);
-							else printf ("Sec: -- ?\n");
-						}
-					}
-					if (flag_debug) printf ("---- Dev: %+12.6lf msec\n", 0.000001 * (diff.tv_nsec - tolerance));
-					noise++;
-				}
+	if (events_on) {
+		out.log = event_ring_add (&events, EVENT_OUTPUT);
+		if (event_start (&events) < 0) {
+			fprintf (stderr, "Can't start thread of the event log! exit.\n");
+			return EXIT_FAILURE;
+		}
+	}
 
-				if (noise < 0) noise = 0;
-				if (noise > 9) edge_dir = 0;
-			}
+// every receiver gets its own decoder thread, the main thread is the output
+// and publishes the results of a single receiver or the fused minutes
+	if (receiver_cnt > 1) fusion_init (&fusion, receiver_cnt, flag_debug);
 
-// syncing
-			else {
-				init_dcf77_time (&time_last);
-				init_dcf77_time (&time_now);
-				init_dcf77_data (&block_data);
-				for (i = 0 ; i < 60 ; i++) data[i] = -1;
-				for (i = 0 ; i < 60 ; i++) sig_stat[i] = 0;
-				init_time_info (&sec_last);
-				init_time_info (&min_last);
-				sig_short = 0;
-				sig_long = 0;
-				sig_cnt = 0;
-				sig_avr = 0;
-				min_cnt = 0;
-				sec_cnt = 0;
-				noise = 0;
-
-				get_diff (&diff, &sig_last, &sig_now, tolerance);
-
-				if (check_tolerance (&diff, 0, 100000000L, tolerance)) {
-					edge_dir = -1;
-					sig_short++;
-					memcpy (&sec_last, &sig_last, sizeof(sig_last));
-					if (flag_debug) printf("found falling edge\n");					
-				}
-				if (check_tolerance (&diff, 0, 200000000L, tolerance)) {
-					edge_dir = -1;
-					sig_long++;
-					memcpy (&sec_last, &sig_last, sizeof(sig_last));
-					if (flag_debug) printf("found falling edge\n");					
-				}
-				if (check_tolerance (&diff, 0, 800000000L, tolerance) || check_tolerance (&diff, 0, 900000000L, tolerance)) {
-					edge_dir =  1;
-					memcpy (&sec_last, &sig_now, sizeof(sig_now));
-					if (flag_debug) printf("found rising edge\n");
-				}
-				if (check_tolerance (&diff, 1, 800000000L, tolerance) || check_tolerance (&diff, 1, 900000000L, tolerance)) {
-					edge_dir =  1;
-					memcpy (&sec_last, &sig_now, sizeof(sig_now));
-					memcpy (&min_last, &sig_now, sizeof(sig_now));
-					if (flag_debug) printf("found rising edge\n");
-				}
-				if (edge_dir == 0 && flag_debug) printf("syncing...\n");
-			}
-			memcpy (&sig_last, &sig_now, sizeof(sig_now));
-			fflush (stdout);
+	for (i = 0 ; i < receiver_cnt ; i++) {
+		if (pthread_create (&receiver[i].thread, NULL, receiver_thread, &receiver[i]) == 0) {
+			receiver[i].running = 1;
+		}
+		else {
+			fprintf (stderr, "Can't start thread of receiver %d! exit.\n", i);
+			quit (0);
 		}
+	}
+
+	if (receiver_cnt > 1) fusion_loop (&out);
+	else output_loop (&out, &receiver[0]);
 
-		delay(10);
+	for (i = 0 ; i < receiver_cnt ; i++) {
+		if (receiver[i].running) pthread_join (receiver[i].thread, NULL);
 	}
 
 	if (ntp_shm) shmdt ((void *) ntp_shm);
+	if (trace_fd >= 0) close (trace_fd);
+	if (events_on) event_stop (&events);
 
 	return 0;
 }
-
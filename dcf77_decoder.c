@@ -0,0 +1,1479 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * decoder state machine, turns edges into minutes.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <math.h>
+
+#include "dcf77_decoder.h"
+#include "dcf77_civil.h"
+
+char *weekday[8] = {
+	" --none-- ", "Monday    ", "Tuesday   ", "Wednesday ", "Thursday  ", "Friday    ", "Saturday  ", "Sunday    "
+};
+
+void set_time_info (time_info_t *info, const edge_t *edge) {
+	info->time.tv_sec   = edge->mono / 1000000000LL;
+	info->time.tv_nsec  = edge->mono % 1000000000LL;
+	info->clock.tv_sec  = edge->real / 1000000000LL;
+	info->clock.tv_nsec = edge->real % 1000000000LL;
+}
+
+
+
+void get_diff (struct timespec *diff, const time_info_t const *old, const time_info_t const *new, const long tolerance) {
+
+	diff->tv_sec = new->time.tv_sec - old->time.tv_sec;
+	diff->tv_nsec = (new->time.tv_nsec - old->time.tv_nsec) + tolerance;
+
+	if (diff->tv_nsec >= 1000000000L) {
+		diff->tv_sec++;
+		diff->tv_nsec -= 1000000000L;
+	}
+
+	if (diff->tv_nsec < 0L) {
+		diff->tv_sec--;
+		diff->tv_nsec += 1000000000L;
+	}
+}
+
+
+
+int check_tolerance (struct timespec *diff, const long sec, const long nsec, const long tolerance) {
+
+//	printf ("check tolerance %ld %10ld <-> %ld %10ld (%ld) ... ", diff->tv_sec, diff->tv_nsec, sec, nsec, tolerance);
+
+	if (diff->tv_sec == sec && diff->tv_nsec >= nsec && diff->tv_nsec <= (nsec + (2 * tolerance))) {
+//		printf ("ok\n");
+		return 1;
+	}
+//	printf ("fail\n");
+	return 0;
+}
+
+
+
+int get_second (const struct timespec const *diff, const time_info_t const *min, const time_info_t const *sig, const long tolerance) {
+
+	struct timespec sec_diff;
+	int second = 0;
+
+	if (min->time.tv_sec) {
+		get_diff (&sec_diff, min, sig, tolerance);
+		second = sec_diff.tv_sec;
+	}
+
+	return second;
+}
+
+
+
+void frame_init (dcf77_frame *frame) {
+	frame->value = 0;
+	frame->valid = 0;
+}
+
+
+
+void frame_set (dcf77_frame *frame, const int bit, const int value) {
+
+	if (bit < 0 || bit > 59) return;
+
+	frame->valid |= 1ULL << bit;
+	if (value) frame->value |= 1ULL << bit;
+	else frame->value &= ~(1ULL << bit);
+}
+
+
+
+// return -1 if the bit was not received
+int frame_get (const dcf77_frame *frame, const int bit) {
+	if (bit < 0 || bit > 59 || ((frame->valid >> bit) & 1) == 0) return -1;
+	return (frame->value >> bit) & 1;
+}
+
+
+
+void frame_pack (dcf77_frame *frame, const int8_t *data) {
+
+	int i;
+
+	frame_init (frame);
+	for (i = 0 ; i < 60 ; i++) if (data[i] >= 0) frame_set (frame, i, data[i]);
+}
+
+
+
+void frame_unpack (const dcf77_frame *frame, int8_t *data) {
+
+	int i;
+
+	for (i = 0 ; i < 60 ; i++) data[i] = frame_get (frame, i);
+}
+
+
+
+// mask of 'count' bits starting at bit 'first'
+#define FRAME_MASK(first, count) (((1ULL << (count)) - 1) << (first))
+
+// move the bits of second 0 to 58 'count' seconds later, second 59 is kept
+static void frame_shift (dcf77_frame *frame, const int count) {
+
+	const uint64_t mask = FRAME_MASK (0, 59);
+
+	if (count > 58) {
+		frame->value &= ~mask;
+		frame->valid &= ~mask;
+		return;
+	}
+
+	frame->value = ((frame->value << count) & mask) | (frame->value & ~mask);
+	frame->valid = ((frame->valid << count) & mask) | (frame->valid & ~mask);
+}
+
+// return 1 if parity is okay, 0 if not all bits are received
+static int check_parity (const dcf77_frame *frame, const int first, const int count) {
+
+	uint64_t mask = FRAME_MASK (first, count);
+
+	if ((frame->valid & mask) != mask) return 0;
+	return __builtin_popcountll (frame->value & mask) & 1 ? -1 : 1;
+}
+
+
+
+static const int8_t bcd_digit[16] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1
+};
+
+// return the BCD number of 'count' bits starting at bit 'first' if it is in possible range from start to end
+// otherwise return -1
+static int check_number (const dcf77_frame *frame, const int first, const int count, const int start, const int end) {
+
+	uint64_t mask = FRAME_MASK (first, count);
+	unsigned int bcd;
+	int number;
+
+	if ((frame->valid & mask) != mask) return -1;
+
+	bcd = (frame->value & mask) >> first;
+	if (bcd_digit[bcd & 0x0f] < 0 || bcd_digit[bcd >> 4] < 0) return -1;
+
+	number = bcd_digit[bcd >> 4] * 10 + bcd_digit[bcd & 0x0f];
+	if (number < start || number > end) return -1;
+	return number;
+}
+
+
+
+int check_data_sync (const dcf77_frame *frame) {
+
+	switch (frame_get (frame, 0)) {
+		case 0: return 1;
+		case 1: return -1;
+	}
+	return 0;
+}
+
+
+
+int check_data_tz (const dcf77_frame *frame, int8_t *tz) {
+
+	if ((frame->valid & FRAME_MASK (17, 2)) == FRAME_MASK (17, 2)) {
+		switch ((frame->value >> 17) & 3) {
+			case 2: *tz = 1; return 1;	// bit 18: CET
+			case 1: *tz = 2; return 1;	// bit 17: CEST
+		}
+	}
+	*tz = -1;
+	return -1;
+}
+
+
+
+int check_data_time (const dcf77_frame *frame) {
+	return frame_get (frame, 20) == 1 ? 1 : -1;
+}
+
+
+
+void check_data_min (const dcf77_frame *frame, int8_t *min) {
+	if (check_parity (frame, 21, 8) > 0) *min = check_number (frame, 21, 7, 0, 59);
+}
+
+
+
+void check_data_hour (const dcf77_frame *frame, int8_t *hour) {
+	if (check_parity (frame, 29, 7) > 0) *hour = check_number (frame, 29, 6, 0, 23);
+}
+
+
+
+void check_data_dst (const dcf77_frame *frame, int8_t hour, int8_t *dst) {
+	*dst = frame_get (frame, 16);
+}
+
+
+
+void check_data_day (const dcf77_frame *frame, int8_t *day) {
+	*day = check_number (frame, 36, 6, 1, 31);
+}
+
+
+
+void check_data_wday (const dcf77_frame *frame, int8_t *wday) {
+	*wday = check_number (frame, 42, 3, 1, 7);
+}
+
+
+
+// a missing tens bit of the month counts as zero
+void check_data_mon (const dcf77_frame *frame, int8_t *mon) {
+	*mon = check_number (frame, 45, 4, 0, 9);
+	if (*mon >= 0 && frame_get (frame, 49) > 0) *mon += 10;
+	if (*mon < 1 || *mon > 12) *mon = -1;
+}
+
+
+
+void check_data_year (const dcf77_frame *frame, int8_t *year) {
+	*year = check_number (frame, 50, 8, 0, 99);
+}
+
+
+
+int check_data_date (const dcf77_frame *frame) {
+	return check_parity (frame, 36, 23);
+}
+
+
+
+int check_data_lsec (const dcf77_frame *frame, int8_t *lsec, int8_t day, int8_t mon) {
+
+	*lsec = frame_get (frame, 19);
+
+	if (*lsec == 1) {
+		if ((mon == 6 && day == 30) || (mon == 12 && day == 31) || (mon == 3 && day == 31) || (mon == 9 && day == 30)) {
+			return 1;
+		}
+		else {
+			*lsec = -5;
+			return -1;
+		}
+	}
+	if (*lsec == 0) return 1;
+
+	return 0;
+}
+
+
+
+// decode one field of the frame, e.g. as soon as its parity bit is received
+// return 1 if the field is okay, otherwise -1 and the values of the field are set to -1
+int check_field (const dcf77_frame *frame, const int field, dcf77_time *time) {
+
+	switch (field) {
+
+		case FIELD_MIN:
+			time->min = -1;
+			check_data_min (frame, &time->min);
+			return time->min >= 0 ? 1 : -1;
+
+		case FIELD_HOUR:
+			time->hour = -1;
+			check_data_hour (frame, &time->hour);
+			return time->hour >= 0 ? 1 : -1;
+
+		case FIELD_DATE:
+			if (check_data_date (frame) > 0) {
+				check_data_day  (frame, &time->day);
+				check_data_wday (frame, &time->wday);
+				check_data_mon  (frame, &time->mon);
+				check_data_year (frame, &time->year);
+				if (time->day > 0 && time->wday > 0 && time->mon > 0 && time->year >= 0) return 1;
+			}
+			time->day = -1;
+			time->wday = -1;
+			time->mon = -1;
+			time->year = -1;
+			return -1;
+	}
+
+	return -1;
+}
+
+
+
+// the frame that encodes 'stamp', bits 1 to 16 and 19 can't be predicted and stay invalid
+static void frame_number (dcf77_frame *frame, const int first, const int count, const int number) {
+
+	const uint64_t mask = FRAME_MASK (first, count);
+
+	frame->value = (frame->value & ~mask) | ((((uint64_t) (number / 10) << 4 | number % 10) << first) & mask);
+	frame->valid |= mask;
+}
+
+static void frame_parity (dcf77_frame *frame, const int first, const int count) {
+	frame_set (frame, first + count - 1, __builtin_popcountll (frame->value & FRAME_MASK (first, count - 1)) & 1);
+}
+
+void frame_expect (dcf77_frame *frame, const time_t stamp) {
+
+	dcf77_time time;
+
+	frame_init (frame);
+	civil_time (stamp, &time);
+
+	frame_set (frame, 0, 0);
+	frame_set (frame, 17, time.tz == 2);
+	frame_set (frame, 18, time.tz == 1);
+	frame_set (frame, 20, 1);
+	frame_number (frame, 21, 7, time.min);
+	frame_parity (frame, 21, 8);
+	frame_number (frame, 29, 6, time.hour);
+	frame_parity (frame, 29, 7);
+	frame_number (frame, 36, 6, time.day);
+	frame_number (frame, 42, 3, time.wday);
+	frame_number (frame, 45, 5, time.mon);
+	frame_number (frame, 50, 8, time.year);
+	frame_parity (frame, 36, 23);
+}
+
+
+
+// append to the text, a piece that does not fit is counted as lost
+void text_printf (dcf77_text *text, const char *format, ...) {
+
+	va_list ap;
+	int len;
+
+	if (text->lost == 0) {
+		va_start (ap, format);
+		len = vsnprintf (text->buf + text->len, DECODER_TEXT - TEXT_NOTE - text->len, format, ap);
+		va_end (ap);
+		if (len >= 0 && text->len + len < DECODER_TEXT - TEXT_NOTE) {
+			text->len += len;
+			return;
+		}
+	}
+	text->lost++;
+}
+
+
+
+// end the text with a note if some of it was lost and return its length,
+// the thread that prints it sets 'len' to 0 afterwards
+size_t text_done (dcf77_text *text) {
+
+	if (text->lost) {
+		text->len += sprintf (text->buf + text->len, "... %u pieces of text lost\n", text->lost);
+		text->lost = 0;
+	}
+	return text->len;
+}
+
+
+
+void output_time (dcf77_text *text, const dcf77_time *time) {
+	text_printf (text, "Date   : %s, ", time->wday > 0 ? weekday[time->wday] : "-- n/a -- ");
+	if (time->day > 0) text_printf (text, "%02d.", time->day);
+	else  text_printf (text, "--.");
+	if (time->mon > 0) text_printf (text, "%02d.", time->mon);
+	else  text_printf (text, "--.");
+	if (time->year >= 0) text_printf (text, "%4d ", 2000 + time->year);
+	else  text_printf (text, "---- ");
+	if (time->hour >= 0) text_printf (text, "%02d:", time->hour);
+	else  text_printf (text, "--:");
+	if (time->min  >= 0) text_printf (text, "%02d ", time->min);
+	else  text_printf (text, "-- ");
+	if (time->tz > 0) text_printf (text, "%s", time->tz == 1 ? "CET" : "CEST");
+	else text_printf (text, "---");
+	if (time->stamp != 0)
+		text_printf (text, " (Stamp: %ld / Confirm: %d)", time->stamp, time->stamp_chk);
+	else
+		text_printf (text, "\nConfirm:    %2d       %2d %2d  %2d  %2d %2d %2d", time->wday_chk, time->day_chk, time->mon_chk, time->year_chk, time->hour_chk, time->min_chk, time->tz_chk);
+	text_printf (text, "\n");
+
+	if (time->dst  == 1) text_printf (text, "DST change at end of this hour!\n");
+	if (time->lsec  > 0) text_printf (text, "Leap-Second at end of this day!\n");
+	if (time->alert)     text_printf (text, "DCF77-Transmitter set ALERT!\n");
+}
+
+
+
+// the fields of the minute that starts at 'stamp' (UTC), in CET or CEST
+void civil_time (const time_t stamp, dcf77_time *time) {
+
+	const int cest = civil_cest (stamp);
+	const time_t local = stamp + (cest ? 7200 : 3600);
+	const int64_t days = local / 86400;
+	int year, mon, day;
+
+	civil_from_days (days, &year, &mon, &day);
+
+	time->min = (local / 60) % 60;
+	time->hour = (local / 3600) % 24;
+	time->day = day;
+	time->wday = (days + 3) % 7 + 1;
+	time->mon = mon;
+	time->year = year % 100;
+	time->tz = cest ? 2 : 1;
+}
+
+
+
+// with a stamp all fields follow from it, otherwise the fields known so far are counted on
+void add_minute (dcf77_time *dcf, time_info_t *info, const int count) {
+
+	if (info->time.tv_sec) {
+		info->time.tv_sec += count * 60;
+		info->clock.tv_sec += count * 60;
+	}
+
+	if (dcf->stamp) {
+		dcf->stamp += count * 60;
+		civil_time (dcf->stamp, dcf);
+		return;
+	}
+
+	if (dcf->min < 0) return;
+	dcf->min += count;
+	if (dcf->min < 60) return;
+
+	if (dcf->hour >= 0) {
+		dcf->hour += dcf->min / 60;
+		if (dcf->hour >= 24) {
+			if (dcf->wday > 0) dcf->wday = (dcf->wday - 1 + dcf->hour / 24) % 7 + 1;
+			if (dcf->day > 0) {
+				dcf->day += dcf->hour / 24;
+				if (dcf->mon > 0 && dcf->day > civil_month_days (dcf->mon, dcf->year)) {
+					dcf->day -= civil_month_days (dcf->mon, dcf->year);
+					dcf->mon++;
+					if (dcf->mon > 12) {
+						dcf->mon = 1;
+						if (dcf->year >= 0) dcf->year = (dcf->year + 1) % 100;
+					}
+				}
+			}
+			dcf->hour %= 24;
+		}
+	}
+	dcf->min %= 60;
+}
+
+
+
+// seconds since epoch of a complete minute, 0 if the date does not exist or the weekday does not fit
+static time_t dcf77_stamp (const dcf77_time *time) {
+
+	int64_t days;
+
+	if (time->day > civil_month_days (time->mon, time->year)) return 0;
+
+	days = days_from_civil (2000 + time->year, time->mon, time->day);
+	if ((days + 3) % 7 + 1 != time->wday) return 0;
+
+	return days * 86400 + time->hour * 3600 + time->min * 60 - (time->tz == 2 ? 7200 : 3600);
+}
+
+
+
+// 'text' gets the decoded fields for '-D', NULL for none
+void check_data (const dcf77_frame *frame, dcf77_time *now, dcf77_time *last, dcf77_text *text) {
+
+	dcf77_frame expect;
+	uint64_t diff;
+	int check = 0;
+
+	now->check = 0;
+
+	now->check += check_data_sync (frame);
+	now->check += check_data_time (frame);
+	now->check += check_data_tz   (frame, &now->tz);
+	check_data_min  (frame, &now->min);
+	check_data_hour (frame, &now->hour);
+	check_data_dst  (frame, now->hour, &now->dst);
+	check_data_day  (frame, &now->day);
+	check_data_wday (frame, &now->wday);
+	check_data_mon  (frame, &now->mon);
+	check_data_year (frame, &now->year);
+	now->check += check_data_date (frame);
+	now->check += check_data_lsec (frame, &now->lsec, now->day, now->mon);
+	if (now->lsec == -5) now->lsec = 0;
+	if (frame_get (frame, 15) == 1) now->alert = 1;
+
+	if (text) {
+		text_printf (text, "--- Split ---\n");
+		output_time (text, now);
+	}
+
+	if (last->stamp == 0) {
+
+		if (last->min >= 0) {
+			now->min_chk = last->min_chk;
+			if (now->min >= 0) {
+				if (now->min == (last->min + 1) % 60) now->min_chk++;
+				else if (last->min_chk > 0) {
+					now->min = (last->min + 1) % 60;
+					now->min_chk--;
+				}
+			}
+			else now->min = (last->min + 1) % 60;
+		}
+
+		if (now->min == 0 && last->hour >= 0) last->hour = (last->hour + 1) % 24;
+
+		if (last->hour >= 0) {
+			now->hour_chk = last->hour_chk;
+			if (now->hour >= 0) {
+				if (now->hour == last->hour) now->hour_chk++;
+				else if (last->hour_chk > 0) {
+					now->hour = last->hour;
+					now->hour_chk--;
+				}
+			}
+			else now->hour = last->hour;
+		}
+
+		if (last->day > 0) {
+			now->day_chk = last->day_chk;
+			if (now->day > 0) {
+				if  (now->day == last->day) now->day_chk++;
+				else if (last->day_chk > 0) {
+					now->day = last->day;
+					now->day_chk--;
+				}
+			}
+			else now->day = last->day;
+		}
+
+		if (last->wday > 0) {
+			now->wday_chk = last->wday_chk;
+			if (now->wday > 0) {
+				if (now->wday == last->wday) now->wday_chk++;
+				else if (last->wday_chk > 0) {
+					now->wday = last->wday;
+					now->wday_chk--;
+				}
+			}
+			else now->wday = last->wday;
+		}
+
+		if (last->mon > 0) {
+			now->mon_chk = last->mon_chk;
+			if (now->mon > 0) {
+				if  (now->mon == last->mon) now->mon_chk++;
+				else if (last->mon_chk > 0) {
+					now->mon = last->mon;
+					now->mon_chk--;
+				}
+			}
+			else now->mon = last->mon;
+		}
+
+		if (last->year >= 0) {
+			now->year_chk = last->year_chk;
+			if (now->year >= 0) {
+				if (now->year == last->year) now->year_chk++;
+				else if (last->year_chk > 0) {
+					now->year = last->year;
+					now->year_chk--;
+				}
+			}
+			else now->year = last->year;
+		}
+
+		if (last->tz > 0) {
+			now->tz_chk = last->tz_chk;
+			if (now->tz > 0) {
+				if   (now->tz == last->tz) now->tz_chk++;
+				else if (last->tz_chk > 0) {
+					now->tz = last->tz;
+					now->tz_chk--;
+				}
+			}
+			else now->tz = last->tz;
+		}
+
+		if (now->min_chk > 1 && now->hour_chk > 1 && now->day_chk > 1 && now->wday_chk > 1 && now->mon_chk > 1 && now->year_chk > 1 && now->tz_chk > 1) {
+			now->stamp = dcf77_stamp (now);
+		}
+	}
+	else {
+
+		now->stamp = last->stamp + 60;
+		now->stamp_chk = last->stamp_chk;
+
+// the bits that differ from the frame expected, a field counts if it is decoded
+		frame_expect (&expect, now->stamp);
+		diff = ((frame->value & frame->valid) ^ expect.value) & expect.valid;
+
+		if (now->min  >= 0 && (diff & FRAME_MASK (21, 8))) check++;
+		if (now->hour >= 0 && (diff & FRAME_MASK (29, 7))) check++;
+		if (now->day  >  0 && (diff & FRAME_MASK (36, 6))) check++;
+		if (now->mon  >  0 && (diff & FRAME_MASK (45, 5))) check++;
+		if (now->year >= 0 && (diff & FRAME_MASK (50, 8))) check++;
+		if (now->wday >  0 && (diff & FRAME_MASK (42, 3))) check++;
+		if (now->tz   >= 0 && (diff & FRAME_MASK (17, 2))) check++;
+
+		check_field (&expect, FIELD_MIN, now);
+		check_field (&expect, FIELD_HOUR, now);
+		check_field (&expect, FIELD_DATE, now);
+		check_data_tz (&expect, &now->tz);
+
+		if (now->min == 1) {
+			last->dst = 0;
+			last->lsec = 0;
+		}
+
+		if (now->dst) {
+			last->dst += now->dst;
+		}
+
+		if (now->lsec) {
+			last->lsec += now->lsec;
+		}
+
+		if (check) now->stamp_chk--;
+		else now->stamp_chk++;
+
+		if (now->stamp_chk > 10) now->stamp_chk = 10;
+		if (now->stamp_chk < 0) {
+			now->min_chk = 1;
+			now->hour_chk = 1;
+			now->tz_chk = 1;
+			now->day_chk = 1;
+			now->mon_chk = 1;
+			now->wday_chk = 1;
+			now->year_chk = 1;
+			now->stamp = 0;
+		}
+	}
+}
+
+
+
+void init_dcf77_time (dcf77_time *time) {
+	time->min = -2;
+	time->min_chk = 0;
+	time->hour = -2;
+	time->hour_chk = 0;
+	time->day = -2;
+	time->day_chk = 0;
+	time->wday = -2;
+	time->wday_chk = 0;
+	time->mon = -2;
+	time->mon_chk = 0;
+	time->year = -2;
+	time->year_chk = 0;
+	time->tz = -2;
+	time->tz_chk = 0;
+	time->dst = -2;
+	time->check = -50;
+	time->lsec = 0;
+	time->alert = 0;
+	time->stamp = 0;
+	time->stamp_chk = 0;
+}
+
+void init_time_info (time_info_t *info) {
+	info->time.tv_sec = 0;
+	info->time.tv_nsec = 0;
+	info->clock.tv_sec = 0;
+	info->clock.tv_nsec = 0;
+}
+
+
+
+// forget the bits of the current minute
+static void decoder_clear (dcf77_decoder *dec) {
+	frame_init (&dec->frame);
+	init_dcf77_time (&dec->time_part);
+	memset (dec->field_conf, 0, sizeof (dec->field_conf));
+	dec->field_done = 0;
+	dec->min_bits = 0;
+	dec->min_err = 0;
+}
+
+
+
+void decoder_init (dcf77_decoder *dec, const long tolerance, const int debug) {
+
+	memset (dec, 0, sizeof (*dec));
+
+	dec->tolerance = tolerance;
+	dec->debug = debug;
+	dec->precision = 5 * 16;
+
+	init_dcf77_time (&dec->time_last);
+	init_dcf77_time (&dec->time_now);
+
+	decoder_clear (dec);
+	stats_init (&dec->stats, tolerance);
+
+	init_time_info (&dec->sig_now);
+	init_time_info (&dec->sig_last);
+	init_time_info (&dec->sec_last);
+	init_time_info (&dec->min_last);
+}
+
+
+
+// next free result, the oldest one is dropped if nobody polls
+static dcf77_result *decoder_result (dcf77_decoder *dec, const int type) {
+
+	dcf77_result *res = &dec->res[dec->res_head % DECODER_RESULTS];
+
+	dec->res_head++;
+	if (dec->res_head - dec->res_tail > DECODER_RESULTS) dec->res_tail++;
+
+	memset (res, 0, sizeof (*res));
+	res->type = type;
+	return res;
+}
+
+
+
+// follow the minute deviation slowly with the precision (in 1/16 of a power of two), never above 'limit' (0 for none)
+// 'text' gets the precision for '-D', NULL for none
+void update_precision (int *precision, const int limit, const long error, dcf77_text *text) {
+
+	int prec;
+	long tmp = error < 0 ? -error : error;
+
+	if      (tmp <       950) prec = 20 * 16;
+	else if (tmp <      1900) prec = 19 * 16;
+	else if (tmp <      3800) prec = 18 * 16;
+	else if (tmp <      7625) prec = 17 * 16;
+	else if (tmp <     15250) prec = 16 * 16;
+	else if (tmp <     30500) prec = 15 * 16;
+	else if (tmp <     61025) prec = 14 * 16;
+	else if (tmp <    122050) prec = 13 * 16;
+	else if (tmp <    244125) prec = 12 * 16;
+	else if (tmp <    488250) prec = 11 * 16;
+	else if (tmp <    976500) prec = 10 * 16;
+	else if (tmp <   1953125) prec =  9 * 16;
+	else if (tmp <   3906250) prec =  8 * 16;
+	else if (tmp <   7812500) prec =  7 * 16;
+	else if (tmp <  15625000) prec =  6 * 16;
+	else                      prec =  5 * 16;
+	if (limit && prec > limit) prec = limit;
+
+	if (prec > *precision) (*precision)++;
+	if (prec < *precision) *precision -= 2;
+	if (limit && *precision > limit) *precision = limit;
+
+	if (text) {
+		text_printf (text, "Prec_now : %d\n", prec);
+		text_printf (text, "Precision: %d (%d)\n", *precision, -(*precision >> 4));
+	}
+}
+
+
+
+// quality of the last pulse in percent, by its deviation from the average
+static int pulse_quality (const dcf77_decoder *dec) {
+
+	long signal = dec->sig_stat[dec->sig_cnt] - dec->sig_avr;
+
+	if (signal < 0) signal = -signal;
+	signal = (dec->tolerance - signal) / (dec->tolerance / 100);
+	if (signal < 0) signal = 0;
+	if (signal > 100) signal = 100;
+
+	return signal;
+}
+
+
+
+// bit of the current second, -1 without pulse or if both widths were seen equally often
+static int pulse_bit (const dcf77_decoder *dec) {
+	if (dec->sig_short && dec->sig_long == 0) return 0;
+	if (dec->sig_short == 0 && dec->sig_long) return 1;
+	if (dec->sig_short && dec->sig_long && dec->sig_short < dec->sig_long) return 0;
+	if (dec->sig_short && dec->sig_long && dec->sig_short > dec->sig_long) return 1;
+	return -1;
+}
+
+
+
+// confidence of the current bit: the quality of the best pulse, halved if both widths were seen
+static int pulse_conf (const dcf77_decoder *dec) {
+
+	int conf = pulse_bit (dec) ? dec->sig_long_q : dec->sig_short_q;
+
+	if (dec->sig_short && dec->sig_long) conf /= 2;
+	return conf;
+}
+
+
+
+// store the bit of the last second
+static void store_bit (dcf77_decoder *dec) {
+
+	const int sec = dec->sec_cnt;
+
+	if (pulse_bit (dec) >= 0 && sec >= 0 && sec < 60) {
+		frame_set (&dec->frame, sec, pulse_bit (dec));
+		dec->conf[sec] = pulse_conf (dec);
+
+// compare with the frame expected from the last minute
+		if (dec->time_last.stamp && dec->expect_stamp != dec->time_last.stamp + 60) {
+			dec->expect_stamp = dec->time_last.stamp + 60;
+			frame_expect (&dec->expect, dec->expect_stamp);
+		}
+		if (dec->time_last.stamp && frame_get (&dec->expect, sec) >= 0) {
+			dec->stats.bit_cnt++;
+			dec->min_bits++;
+			if (frame_get (&dec->expect, sec) != pulse_bit (dec)) {
+				dec->stats.bit_err++;
+				dec->min_err++;
+				if (dec->debug) text_printf (&dec->text, "Bit %02d: %d, expected %d\n", sec, pulse_bit (dec), frame_get (&dec->expect, sec));
+			}
+		}
+	}
+
+	dec->sig_short = 0;
+	dec->sig_long = 0;
+	dec->sig_short_q = 0;
+	dec->sig_long_q = 0;
+}
+
+
+
+static int64_t info_ns (const time_info_t *info) {
+	return info->time.tv_sec * 1000000000LL + info->time.tv_nsec;
+}
+
+
+
+// a record of the event log, stamped with the edge that is decoded now
+static void decoder_event (dcf77_decoder *dec, const int type, const int a, const int b, const int64_t value) {
+	if (dec->log) event_put (dec->log, type, info_ns (&dec->sig_now), dec->sig_now.clock.tv_sec * 1000000000LL + dec->sig_now.clock.tv_nsec, a, b, value);
+}
+
+
+
+static void info_add (time_info_t *info, const int64_t ns) {
+
+	int64_t time = info_ns (info) + ns;
+	int64_t clock = info->clock.tv_sec * 1000000000LL + info->clock.tv_nsec + ns;
+
+	info->time.tv_sec = time / 1000000000LL;
+	info->time.tv_nsec = time % 1000000000LL;
+	info->clock.tv_sec = clock / 1000000000LL;
+	info->clock.tv_nsec = clock % 1000000000LL;
+}
+
+
+
+static int pll_locked (const dcf77_decoder *dec) {
+	return dec->pll_lock >= PLL_LOCKED;
+}
+
+
+
+// drift of the receiver over 'count' seconds in nsec
+static int64_t pll_drift (const dcf77_decoder *dec, const int count) {
+	return count * dec->pll_freq / (1 << PLL_FRAC);
+}
+
+
+
+// return 1 if the edge is a second mark, 'diff' is the time since the last second start
+// the window is only half the tolerance while locked
+static int pll_check (const dcf77_decoder *dec, const struct timespec *diff) {
+
+	long err = diff->tv_nsec - dec->tolerance - pll_drift (dec, diff->tv_sec);
+
+	if (diff->tv_sec == 0) return 0;
+	if (pll_locked (dec)) return err >= -dec->tolerance / 2 && err <= dec->tolerance / 2;
+	return err >= -dec->tolerance && err <= dec->tolerance;
+}
+
+
+
+// move the start of the second to the second mark 'count' seconds later, filtered by the loop
+static void pll_update (dcf77_decoder *dec, const struct timespec *diff) {
+
+	const int count = diff->tv_sec;
+	long err = diff->tv_nsec - dec->tolerance - pll_drift (dec, count);
+
+	info_add (&dec->sec_last, count * 1000000000LL + pll_drift (dec, count) + err / PLL_GAIN_P);
+
+	dec->pll_freq += (int64_t) err * (1 << PLL_FRAC) / (PLL_GAIN_I * count);
+	if (dec->pll_freq >  (PLL_FREQ_MAX << PLL_FRAC)) dec->pll_freq =  (PLL_FREQ_MAX << PLL_FRAC);
+	if (dec->pll_freq < -(PLL_FREQ_MAX << PLL_FRAC)) dec->pll_freq = -(PLL_FREQ_MAX << PLL_FRAC);
+
+	dec->pll_err = err;
+	dec->pll_mark = info_ns (&dec->sig_now);
+	if (dec->pll_lock < 2 * PLL_LOCKED) dec->pll_lock++;
+
+	if (dec->debug) text_printf (&dec->text, "PLL -> Err: %+12.6lf msec / Freq: %+9.3lf ppm%s\n", 0.000001 * err,
+		0.001 * dec->pll_freq / (1 << PLL_FRAC), pll_locked (dec) ? " / locked" : "");
+}
+
+
+
+// estimated error of the filtered second start in nsec
+// a locked loop averages the noise of the marks down to about a quarter
+static long pll_residual (const dcf77_decoder *dec) {
+
+	double dev = sqrt (dec->stats.stat[STATS_SECOND].var);
+
+	if (pll_locked (dec)) dev /= 4;
+	return dev;
+}
+
+
+
+// the filtered start of the current second, realtime is taken from the last edge
+static void pll_phase (const dcf77_decoder *dec, time_info_t *mark) {
+	*mark = dec->sig_now;
+	info_add (mark, info_ns (&dec->sec_last) - info_ns (&dec->sig_now));
+}
+
+
+
+// without second mark for 'count' seconds the second start runs free
+static void pll_advance (dcf77_decoder *dec, const int count) {
+	info_add (&dec->sec_last, count * 1000000000LL + pll_drift (dec, count));
+}
+
+
+
+// decode a field as soon as the pulse of its parity bit is received
+static void decoder_field (dcf77_decoder *dec) {
+
+	static const int8_t field_first[FIELDS] = { 21, 29, 36 };
+	static const int8_t field_last[FIELDS]  = { 28, 35, 58 };
+	static const char *field_name[FIELDS] = { "minute", "hour", "date" };
+	dcf77_frame frame = dec->frame;
+	dcf77_result *res;
+	int field, i, sum, ok;
+
+	if (dec->min_last.time.tv_sec == 0 || pulse_bit (dec) < 0) return;
+
+	for (field = 0 ; field < FIELDS && field_last[field] != dec->sec_cnt ; field++);
+	if (field >= FIELDS || (dec->field_done & (1 << field))) return;
+	dec->field_done |= 1 << field;
+
+	frame_set (&frame, dec->sec_cnt, pulse_bit (dec));
+	ok = check_field (&frame, field, &dec->time_part) > 0;
+
+// missing bits count as zero confidence
+	sum = pulse_conf (dec);
+	for (i = field_first[field] ; i < field_last[field] ; i++) {
+		if (frame_get (&frame, i) >= 0) sum += dec->conf[i];
+	}
+	dec->field_conf[field] = ok ? sum / (field_last[field] - field_first[field] + 1) : 0;
+
+	res = decoder_result (dec, RESULT_FIELD);
+	res->field = field;
+	res->time = dec->time_part;
+	res->edge = dec->sig_now;
+	memcpy (res->field_conf, dec->field_conf, sizeof (res->field_conf));
+
+	if (dec->debug) text_printf (&dec->text, "Early %s: %s / Confidence: %d%%\n", field_name[field], ok ? "ok" : "fail", dec->field_conf[field]);
+}
+
+
+
+// with a prior a single minute with all parities okay is enough, if it is the minute expected
+static void decoder_resume (dcf77_decoder *dec) {
+
+	dcf77_time part;
+	int64_t mono = info_ns (&dec->sig_now), real, elapsed;
+	time_t expect;
+
+	if (dec->prior.time.stamp == 0) return;
+	if (dec->time_now.stamp || dec->time_last.stamp) {
+		dec->prior.time.stamp = 0;
+		return;
+	}
+
+	init_dcf77_time (&part);
+	if (check_data_sync (&dec->frame) <= 0 || check_data_time (&dec->frame) <= 0 || check_data_tz (&dec->frame, &part.tz) <= 0) return;
+	if (check_field (&dec->frame, FIELD_MIN, &part) <= 0 || check_field (&dec->frame, FIELD_HOUR, &part) <= 0 || check_field (&dec->frame, FIELD_DATE, &part) <= 0) return;
+
+// the monotonic clock only counts within the same boot
+	real = dec->sig_now.clock.tv_sec * 1000000000LL + dec->sig_now.clock.tv_nsec;
+	elapsed = real - dec->prior.real;
+	if (mono > dec->prior.mono && llabs (mono - dec->prior.mono - elapsed) < 10000000000LL) elapsed = mono - dec->prior.mono;
+	if (elapsed < 0) return;
+
+	expect = dec->prior.time.stamp + (elapsed + 30000000000LL) / 60000000000LL * 60;
+	part.stamp = dcf77_stamp (&part);
+	if (part.stamp != expect) {
+		if (dec->debug) text_printf (&dec->text, "Resume: minute does not match the prior (%+ld sec)\n", (long) (part.stamp - expect));
+		return;
+	}
+
+	dec->time_now.min = part.min;
+	dec->time_now.hour = part.hour;
+	dec->time_now.day = part.day;
+	dec->time_now.wday = part.wday;
+	dec->time_now.mon = part.mon;
+	dec->time_now.year = part.year;
+	dec->time_now.tz = part.tz;
+	dec->time_now.min_chk = dec->time_now.hour_chk = dec->time_now.day_chk = dec->time_now.wday_chk = 2;
+	dec->time_now.mon_chk = dec->time_now.year_chk = dec->time_now.tz_chk = 2;
+	dec->time_now.stamp = part.stamp;
+	dec->prior.time.stamp = 0;
+
+	if (dec->debug) text_printf (&dec->text, "Resume: minute matches the prior after %lld sec\n", (long long) (elapsed / 1000000000LL));
+}
+
+
+
+// a pulse of 100 msec (bit 0) or 200 msec (bit 1), 'diff' is the time since the start of the second
+static void decoder_pulse (dcf77_decoder *dec, const struct timespec *diff, const int bit) {
+
+	const long width = bit ? 200000000L : 100000000L;
+	long signal;
+	int quality;
+
+	if (bit) dec->sig_long++;
+	else dec->sig_short++;
+
+	dec->sig_sum -= dec->sig_stat[dec->sig_cnt];
+	dec->sig_stat[dec->sig_cnt] = diff->tv_nsec - dec->tolerance - width;
+	dec->sig_sum += dec->sig_stat[dec->sig_cnt];
+	dec->sig_avr = dec->sig_sum / 60;
+	stats_add (&dec->stats.stat[bit ? STATS_LONG : STATS_SHORT], dec->sig_stat[dec->sig_cnt]);
+
+	quality = pulse_quality (dec);
+	if (bit && quality > dec->sig_long_q) dec->sig_long_q = quality;
+	if (bit == 0 && quality > dec->sig_short_q) dec->sig_short_q = quality;
+
+	signal = dec->sig_stat[dec->sig_cnt] - dec->sig_avr;
+	if (signal < 0) signal = -signal;
+	signal = (dec->tolerance - signal) / (dec->tolerance / 100);
+	decoder_event (dec, EVENT_PULSE, bit, signal, (diff->tv_nsec - dec->tolerance - width) - dec->sig_avr);
+	if (dec->debug) text_printf (&dec->text, "%d -> Dev: %+12.6lf msec / Signal: %ld%%\n", bit, 0.000001 * ((diff->tv_nsec - dec->tolerance - width) - dec->sig_avr), signal);
+	decoder_field (dec);
+
+	dec->sig_cnt++;
+	if (dec->sig_cnt >= 60) dec->sig_cnt = 0;
+	dec->noise--;
+}
+
+
+
+// decode one edge
+static void decoder_edge (dcf77_decoder *dec, const edge_t *edge) {
+
+	dcf77_result *res;
+	struct timespec diff, start, stop;
+	int i, j, first, gap, bit_err;
+	long signal;
+
+	set_time_info (&dec->sig_now, edge);
+	dec->stats.edges++;
+	decoder_event (dec, EVENT_EDGE, edge->level, edge->pin, 0);
+
+	if (dec->sig_now.time.tv_nsec != dec->sig_last.time.tv_nsec || dec->sig_now.time.tv_sec != dec->sig_last.time.tv_sec) {
+
+		if (dec->edge_dir != 0) {
+
+			get_diff (&diff, &dec->sec_last, &dec->sig_now, dec->tolerance);
+
+
+
+
+
+// check for second marker
+			if (pll_check (dec, &diff)) {
+
+// seconds since the last second with mark or pulse, noise in between does not count
+				gap = (info_ns (&dec->sig_now) - dec->sec_seen + 500000000LL) / 1000000000LL;
+				dec->sec_seen = info_ns (&dec->sig_now);
+
+// store data
+				store_bit (dec);
+				stats_add (&dec->stats.stat[STATS_SECOND], diff.tv_nsec - dec->tolerance);
+
+// calculate starting second
+				if (dec->min_last.time.tv_sec)
+					dec->sec_cnt = get_second (&diff, &dec->min_last, &dec->sig_now, dec->tolerance);
+				else
+					dec->sec_cnt += diff.tv_sec;
+
+// check more then a minute
+				if (dec->sec_cnt > 59 && gap != 2) {
+					dec->min_cnt++;
+					decoder_clear (dec);
+
+					if (dec->min_cnt > 2) {
+						if (dec->debug) text_printf (&dec->text, "search for new minute start...\n");
+						decoder_result (dec, RESULT_RESYNC);
+						dec->stats.resyncs++;
+						decoder_event (dec, EVENT_RESYNC, 0, 0, 0);
+						init_time_info (&dec->min_last);
+						init_dcf77_time (&dec->time_last);
+						dec->min_cnt = 0;
+					}
+					else {
+						add_minute (&dec->time_last, &dec->min_last, dec->sec_cnt / 60);
+					}
+					dec->sec_cnt -= (dec->sec_cnt / 60) * 60;
+				}
+
+				pll_update (dec, &diff);
+
+				signal = diff.tv_nsec - dec->tolerance;
+				if (signal < 0) signal = -signal;
+				signal = (dec->tolerance - signal) / (dec->tolerance / 100);
+				decoder_event (dec, EVENT_MARK, dec->min_last.time.tv_sec ? dec->sec_cnt : -1, signal, diff.tv_nsec - dec->tolerance);
+
+				if (dec->debug) {
+					text_printf (&dec->text, "= -> Dev: %+12.6lf msec / Signal: %ld%%\n", 0.000001 * (diff.tv_nsec - dec->tolerance), signal);
+					if (dec->min_last.time.tv_sec)
+						text_printf (&dec->text, "Sec: %02d\n", dec->sec_cnt);
+					else
+						text_printf (&dec->text, "Sec: --\n");
+				}
+
+// hand over the second mark with the time predicted from the last minute, second 0 is the minute
+// a second that is not polled yet is stale, it is replaced
+				if (dec->seconds && dec->min_last.time.tv_sec && dec->sec_cnt > 0) {
+					if (dec->res_head != dec->res_tail && dec->res[(dec->res_head - 1) % DECODER_RESULTS].type == RESULT_SECOND) dec->res_head--;
+					res = decoder_result (dec, RESULT_SECOND);
+					res->time = dec->time_last;
+					if (res->time.stamp) res->time.stamp += dec->sec_cnt;
+					res->second = dec->sec_cnt;
+					res->edge = dec->sig_now;
+					pll_phase (dec, &res->mark);
+					res->residual = pll_residual (dec);
+					res->precision = -(dec->precision >> 4);
+				}
+
+// hand over bits 1 to 14 once per minute
+				if (dec->sec_cnt > 14 && dec->time_last.stamp && dec->data_stamp != dec->time_last.stamp) {
+					dec->data_stamp = dec->time_last.stamp;
+					res = decoder_result (dec, RESULT_DATA);
+					res->time = dec->time_last;
+					frame_unpack (&dec->frame, res->data);
+				}
+
+// check for minute marker
+				if (dec->min_last.time.tv_sec == 0 && gap == 2) {
+					memcpy (&dec->min_last, &dec->sig_now, sizeof(dec->sig_now));
+					dec->min_last.time.tv_sec -= 60;
+					dec->min_last.clock.tv_sec -= 60;
+					if (dec->sec_cnt < 59) {
+						for (i = 58 ; i >= 0 && frame_get (&dec->frame, i) == -1 ; i--);
+						for (j = 58 ; i >= 0 ; j--, i--) dec->conf[j] = dec->conf[i];
+						frame_shift (&dec->frame, j + 1);
+					}
+				}
+
+// check minute
+				if (dec->min_last.time.tv_sec && gap == 2) {
+					get_diff (&diff, &dec->min_last, &dec->sig_now, dec->tolerance);
+					if (diff.tv_sec == 60) {
+
+						if (dec->debug) {
+							text_printf (&dec->text, "Minute-Data:\n");
+							for (i = 0 ; i < 60 ; i++) {
+								if ((i % 10) == 0) text_printf (&dec->text, "%02d: ", i);
+								text_printf (&dec->text, "%2d ", frame_get (&dec->frame, i));
+								if ((i % 10) == 9) text_printf (&dec->text, "\n");
+								else text_printf (&dec->text, " ");
+							}
+							text_printf (&dec->text, "--- Last ---\n");
+							output_time (&dec->text, &dec->time_last);
+						}
+
+						dec->min_dev = ((dec->min_dev * 15) + (diff.tv_nsec - dec->tolerance)) / 16;
+
+// parity failures of the fields, missing bits don't count
+						dec->stats.minutes++;
+						if (check_parity (&dec->frame, 21, 8) < 0) dec->stats.parity[FIELD_MIN]++;
+						if (check_parity (&dec->frame, 29, 7) < 0) dec->stats.parity[FIELD_HOUR]++;
+						if (check_parity (&dec->frame, 36, 23) < 0) dec->stats.parity[FIELD_DATE]++;
+
+// hand over the raw bits for the fusion of receivers
+						if (dec->frames) {
+							res = decoder_result (dec, RESULT_FRAME);
+							res->edge = dec->sig_now;
+							pll_phase (dec, &res->mark);
+							res->residual = pll_residual (dec);
+							frame_unpack (&dec->frame, res->data);
+							memcpy (res->conf, dec->conf, sizeof (res->conf));
+							res->min_dev = dec->min_dev;
+							res->sig_avr = dec->sig_avr;
+						}
+
+						bit_err = dec->min_bits ? dec->min_err : -1;
+						if (dec->debug && bit_err >= 0) text_printf (&dec->text, "Bit errors: %d of %d bits expected\n", bit_err, dec->min_bits);
+
+						if (dec->bench) clock_gettime (CLOCK_MONOTONIC, &start);
+						check_data (&dec->frame, &dec->time_now, &dec->time_last, dec->debug ? &dec->text : NULL);
+						if (dec->bench) {
+							clock_gettime (CLOCK_MONOTONIC, &stop);
+							dec->check_ns += (stop.tv_sec - start.tv_sec) * 1000000000LL + (stop.tv_nsec - start.tv_nsec);
+							dec->check_cnt++;
+						}
+						decoder_resume (dec);
+						decoder_clear (dec);
+
+						if (dec->debug) {
+							text_printf (&dec->text, "--- Now ---\n");
+							output_time (&dec->text, &dec->time_now);
+							text_printf (&dec->text, "Average Minute Deviation: %+12.6lf msec\n", 0.000001 * dec->min_dev);
+							text_printf (&dec->text, "Average Signal Deviation: %+12.6lf msec\n", 0.000001 * dec->sig_avr);
+							text_printf (&dec->text, "Minute Start Stamp: %10ld.%09ld\n", dec->sig_now.time.tv_sec, dec->sig_now.time.tv_nsec);
+							text_printf (&dec->text, "Sec: 00\n");
+						}
+
+						first = dec->time_last.stamp == 0 && dec->time_now.stamp;
+
+						memcpy (&dec->time_last, &dec->time_now, sizeof(dec->time_now));
+						memcpy (&dec->min_last, &dec->sig_now, sizeof(dec->sig_now));
+						dec->min_cnt = 0;
+						dec->sec_cnt = 0;
+
+// hand over the decoded minute
+						if (dec->time_now.stamp) update_precision (&dec->precision, dec->prec_max, pll_residual (dec), dec->debug ? &dec->text : NULL);
+						res = decoder_result (dec, RESULT_MINUTE);
+						res->time = dec->time_now;
+						res->edge = dec->sig_now;
+						pll_phase (dec, &res->mark);
+						res->residual = pll_residual (dec);
+						res->first = first;
+						res->bit_err = bit_err;
+						res->min_dev = dec->min_dev;
+						res->sig_avr = dec->sig_avr;
+						res->precision = -(dec->precision >> 4);
+						decoder_event (dec, EVENT_MINUTE, dec->time_now.stamp_chk, bit_err, dec->time_now.stamp);
+
+						init_dcf77_time (&dec->time_now);
+					}
+				}
+
+				dec->noise--;
+			}
+
+
+// short signal == binary 0
+			else if (check_tolerance (&diff, 0, 100000000L + dec->sig_avr, dec->tolerance)) {
+				decoder_pulse (dec, &diff, 0);
+			}
+
+// long signal == binary 1
+			else if (check_tolerance (&diff, 0, 200000000L + dec->sig_avr, dec->tolerance)) {
+				decoder_pulse (dec, &diff, 1);
+			}
+
+// noise
+			else {
+				if (diff.tv_sec) {
+// store data
+					store_bit (dec);
+
+					pll_advance (dec, diff.tv_sec);
+					dec->sec_cnt += diff.tv_sec;
+
+					if (dec->sec_cnt > 59) {
+						dec->min_cnt++;
+						decoder_clear (dec);
+
+						if (dec->min_cnt > 2) {
+							if (dec->debug) text_printf (&dec->text, "search for new minute start...\n");
+							decoder_result (dec, RESULT_RESYNC);
+							dec->stats.resyncs++;
+							decoder_event (dec, EVENT_RESYNC, 0, 0, 0);
+							init_time_info (&dec->min_last);
+							init_dcf77_time (&dec->time_last);
+							dec->min_cnt = 0;
+						}
+						else {
+							add_minute (&dec->time_last, &dec->min_last, dec->sec_cnt / 60);
+						}
+						dec->sec_cnt -= (dec->sec_cnt / 60) * 60;
+					}
+					if (dec->debug) {
+						if (dec->min_last.time.tv_sec) text_printf (&dec->text, "Sec: %02d ?\n", dec->sec_cnt);
+						else text_printf (&dec->text, "Sec: -- ?\n");
+					}
+					get_diff (&diff, &dec->sec_last, &dec->sig_now, dec->tolerance);
+				}
+
+// the end of a pulse whose start was lost, second 59 has no pulse
+				if (dec->min_last.time.tv_sec && dec->sec_cnt == 59) {
+					if (dec->debug) text_printf (&dec->text, "---- Dev: %+12.6lf msec\n", 0.000001 * (diff.tv_nsec - dec->tolerance));
+					dec->noise++;
+					dec->stats.noise++;
+					decoder_event (dec, EVENT_NOISE, 0, 0, diff.tv_nsec - dec->tolerance);
+				}
+				else if (check_tolerance (&diff, 0, 100000000L + dec->sig_avr, dec->tolerance)) {
+					dec->sec_seen = info_ns (&dec->sec_last);
+					decoder_pulse (dec, &diff, 0);
+				}
+				else if (check_tolerance (&diff, 0, 200000000L + dec->sig_avr, dec->tolerance)) {
+					dec->sec_seen = info_ns (&dec->sec_last);
+					decoder_pulse (dec, &diff, 1);
+				}
+				else {
+					if (dec->debug) text_printf (&dec->text, "---- Dev: %+12.6lf msec\n", 0.000001 * (diff.tv_nsec - dec->tolerance));
+					dec->noise++;
+					dec->stats.noise++;
+					decoder_event (dec, EVENT_NOISE, 0, 0, diff.tv_nsec - dec->tolerance);
+				}
+			}
+
+// a locked loop keeps the second through noise for a while
+			if (dec->noise < 0) dec->noise = 0;
+			if (dec->noise > 9) {
+				if (pll_locked (dec) && info_ns (&dec->sig_now) - dec->pll_mark < PLL_HOLDOVER) dec->noise = 9;
+				else dec->edge_dir = 0;
+			}
+		}
+
+// syncing
+		else {
+			init_dcf77_time (&dec->time_last);
+			init_dcf77_time (&dec->time_now);
+			decoder_clear (dec);
+// the signal deviation starts from the prior, if there is one
+			for (i = 0 ; i < 60 ; i++) dec->sig_stat[i] = dec->prior.time.stamp ? dec->prior.sig_avr : 0;
+			dec->sig_sum = 60 * dec->sig_stat[0];
+			init_time_info (&dec->sec_last);
+			init_time_info (&dec->min_last);
+			dec->sig_short = 0;
+			dec->sig_long = 0;
+			dec->sig_short_q = 0;
+			dec->sig_long_q = 0;
+			dec->sig_cnt = 0;
+			dec->sig_avr = dec->sig_stat[0];
+			dec->min_cnt = 0;
+			dec->sec_cnt = 0;
+			dec->noise = 0;
+			dec->pll_lock = 0;
+
+			get_diff (&diff, &dec->sig_last, &dec->sig_now, dec->tolerance);
+
+			if (check_tolerance (&diff, 0, 100000000L, dec->tolerance)) {
+				dec->edge_dir = -1;
+				dec->sig_short++;
+				memcpy (&dec->sec_last, &dec->sig_last, sizeof(dec->sig_last));
+				if (dec->debug) text_printf (&dec->text, "found falling edge\n");					
+			}
+			if (check_tolerance (&diff, 0, 200000000L, dec->tolerance)) {
+				dec->edge_dir = -1;
+				dec->sig_long++;
+				memcpy (&dec->sec_last, &dec->sig_last, sizeof(dec->sig_last));
+				if (dec->debug) text_printf (&dec->text, "found falling edge\n");					
+			}
+			if (check_tolerance (&diff, 0, 800000000L, dec->tolerance) || check_tolerance (&diff, 0, 900000000L, dec->tolerance)) {
+				dec->edge_dir =  1;
+				memcpy (&dec->sec_last, &dec->sig_now, sizeof(dec->sig_now));
+				if (dec->debug) text_printf (&dec->text, "found rising edge\n");
+			}
+			if (check_tolerance (&diff, 1, 800000000L, dec->tolerance) || check_tolerance (&diff, 1, 900000000L, dec->tolerance)) {
+				dec->edge_dir =  1;
+				memcpy (&dec->sec_last, &dec->sig_now, sizeof(dec->sig_now));
+				memcpy (&dec->min_last, &dec->sig_now, sizeof(dec->sig_now));
+				if (dec->debug) text_printf (&dec->text, "found rising edge\n");
+			}
+			if (dec->edge_dir == 0 && dec->debug) text_printf (&dec->text, "syncing...\n");
+			decoder_event (dec, EVENT_SYNC, dec->edge_dir, 0, 0);
+			dec->pll_mark = info_ns (&dec->sec_last);
+			dec->sec_seen = dec->pll_mark;
+		}
+		memcpy (&dec->sig_last, &dec->sig_now, sizeof(dec->sig_now));
+	}
+}
+
+
+
+// decode a batch of edges, return the number of edges taken
+// with 'debug' set it stops after an edge with a result or when the text is half full,
+// so the text can be taken and printed in order with the results
+size_t decoder_feed (dcf77_decoder *dec, const edge_t *edge, size_t count) {
+
+	unsigned int head = dec->res_head;
+	size_t i;
+
+	for (i = 0 ; i < count ; i++) {
+		decoder_edge (dec, &edge[i]);
+		if (dec->debug && (dec->res_head != head || dec->text.len > DECODER_TEXT / 2)) return i + 1;
+	}
+
+	return count;
+}
+
+
+
+// fetch the oldest result, return 0 if there is none
+int decoder_poll (dcf77_decoder *dec, dcf77_result *res) {
+
+	if (dec->res_tail == dec->res_head) return 0;
+
+	*res = dec->res[dec->res_tail % DECODER_RESULTS];
+	dec->res_tail++;
+	return 1;
+}
+
+
+
+// what the decoder has learned, to be taken by the thread that feeds the decoder
+// return 0 if there is nothing to keep yet
+int decoder_save (const dcf77_decoder *dec, dcf77_prior *prior) {
+
+	if (dec->time_last.stamp == 0) return 0;
+
+	prior->time = dec->time_last;
+	prior->mono = info_ns (&dec->min_last);
+	prior->real = dec->min_last.clock.tv_sec * 1000000000LL + dec->min_last.clock.tv_nsec;
+	prior->sig_avr = dec->sig_avr;
+	prior->min_dev = dec->min_dev;
+	prior->precision = dec->precision;
+	prior->pll_freq = dec->pll_freq;
+	return 1;
+}
+
+
+
+// the timestamps of the source are not better then 'precision' (power of two like ntpd, 0 for no limit)
+void decoder_limit (dcf77_decoder *dec, const int precision) {
+
+	dec->prec_max = -precision * 16;
+	if (dec->prec_max && dec->precision > dec->prec_max) dec->precision = dec->prec_max;
+}
+
+
+
+// start from a saved state, 'now' is CLOCK_REALTIME in ns
+void decoder_prior (dcf77_decoder *dec, const dcf77_prior *prior, const int64_t now) {
+
+	if (prior->time.stamp == 0 || now < prior->real || now - prior->real > PRIOR_AGE * 1000000000LL) return;
+
+	dec->prior = *prior;
+	dec->min_dev = prior->min_dev;
+	dec->precision = prior->precision;
+	dec->pll_freq = prior->pll_freq;
+
+	if (dec->debug) {
+		text_printf (&dec->text, "Prior of %lld sec ago:\n", (long long) ((now - prior->real) / 1000000000LL));
+		output_time (&dec->text, &dec->prior.time);
+	}
+}
+
+
+
+// copy of the pulse statistics, to be taken by the thread that feeds the decoder
+void decoder_stats (const dcf77_decoder *dec, dcf77_stats *stats) {
+	*stats = dec->stats;
+}
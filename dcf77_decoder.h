@@ -0,0 +1,202 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * decoder state machine, turns edges into minutes.
+ */
+
+#ifndef DCF77_DECODER_H
+#define DCF77_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "dcf77_trace.h"
+#include "dcf77_stats.h"
+#include "dcf77_event.h"
+
+#define RECEIVER_MAX 4	// receivers of one daemon
+
+typedef struct {
+	struct timespec time;
+	struct timespec clock;
+} time_info_t;
+
+typedef struct {
+	int8_t min;
+	int8_t min_chk;
+	int8_t hour;
+	int8_t hour_chk;
+	int8_t day;
+	int8_t day_chk;
+	int8_t wday;
+	int8_t wday_chk;
+	int8_t mon;
+	int8_t mon_chk;
+	int8_t year;
+	int8_t year_chk;
+	int8_t tz;
+	int8_t tz_chk;
+	int8_t dst;
+	int8_t lsec;
+	int8_t alert;
+	int8_t check;
+	int8_t stamp_chk;
+	time_t stamp;
+} dcf77_time;
+
+// a minute packed into two words, bit n is the bit of second n
+typedef struct {
+	uint64_t value;	// bits with value one
+	uint64_t valid;	// bits that are received
+} dcf77_frame;
+
+// the text of '-D', written by a decoder and printed by the thread that takes it
+#define DECODER_TEXT 8192
+#define TEXT_NOTE    64		// kept free for the note of lost text
+
+typedef struct {
+	char buf[DECODER_TEXT];
+	size_t len;
+	unsigned int lost;	// pieces that did not fit, nothing is added until the text is taken
+} dcf77_text;
+
+#define RESULT_MINUTE 1	// a minute is decoded
+#define RESULT_DATA   2	// bits 1 to 14 of a minute with stamp are received
+#define RESULT_FRAME  3	// all bits of a minute, before they are checked (only with 'frames' set)
+#define RESULT_FIELD  4	// a field is decoded as soon as the pulse of its parity bit is received
+#define RESULT_SECOND 5	// a second mark after the minute marker (only with 'seconds' set)
+#define RESULT_RESYNC 6	// the minute start is lost, the decoder searches for a new one
+
+#define FIELD_MIN  0	// bit 21 to 28
+#define FIELD_HOUR 1	// bit 29 to 35
+#define FIELD_DATE 2	// bit 36 to 58
+#define FIELDS     3
+
+typedef struct {
+	int type;
+	int8_t first;		// first stamp after (re)sync
+	dcf77_time time;	// RESULT_MINUTE: the minute that starts now, RESULT_DATA: the current minute
+						// RESULT_FIELD: the fields of the next minute decoded so far
+						// RESULT_SECOND: the current minute, 'stamp' moved to the second (0 if unknown)
+	time_info_t edge;	// edge of the minute marker
+	time_info_t mark;	// minute marker filtered by the loop, realtime taken from 'edge'
+	long residual;		// estimated error of 'mark' in nsec
+	int8_t data[60];	// RESULT_DATA: bit 0 to 14, RESULT_FRAME: all bits
+	uint8_t conf[60];	// RESULT_FRAME: confidence of the bits in percent
+	int field;			// RESULT_FIELD: the field that is decoded now
+	int second;			// RESULT_SECOND: the second of the minute
+	int bit_err;		// RESULT_MINUTE: bits that differ from the frame expected, -1 without stamp
+	uint8_t field_conf[FIELDS];	// RESULT_FIELD: confidence of the fields in percent, 0 if not decoded
+	long min_dev;
+	long sig_avr;
+	int precision;		// as power of two, like ntpd
+} dcf77_result;
+
+#define DECODER_RESULTS 16
+
+// what a decoder has learned, kept over a restart of the daemon
+typedef struct {
+	dcf77_time time;	// the last decoded minute with its checks, no prior if 'stamp' is 0
+	int64_t mono;		// its minute marker, CLOCK_MONOTONIC_RAW in ns
+	int64_t real;		// CLOCK_REALTIME in ns
+	long sig_avr;
+	long min_dev;
+	int precision;
+	int64_t pll_freq;
+} dcf77_prior;
+
+#define PRIOR_AGE 86400LL	// a prior older then a day is not used (sec)
+
+// tracking of the second marks, a PI loop on phase and frequency against CLOCK_MONOTONIC_RAW
+#define PLL_FRAC     8			// pll_freq is in 1/256 nsec per second
+#define PLL_GAIN_P   8			// the phase follows 1/8 of the error
+#define PLL_GAIN_I   128		// the frequency follows 1/128 of the error per second
+#define PLL_FREQ_MAX 1000000LL	// +-1000 ppm
+#define PLL_LOCKED   10			// good second marks until locked
+#define PLL_HOLDOVER 60000000000LL	// keep a lock through noise for 60 sec
+
+typedef struct {
+	long tolerance;
+	int debug;
+
+	time_info_t sig_now;
+	time_info_t min_last;
+	time_info_t sec_last;
+	time_info_t sig_last;
+	int sec_cnt;
+	int min_cnt;
+	int edge_dir;
+	int sig_cnt;
+	int noise;
+	dcf77_frame frame;
+	uint8_t conf[60];
+	dcf77_frame expect;		// the frame predicted from the last minute
+	time_t expect_stamp;	// the minute it encodes
+	int min_bits;			// bits of the current frame compared with 'expect'
+	int min_err;			// and how many of them differ
+	dcf77_time time_part;	// fields of the current frame, decoded before the minute ends
+	uint8_t field_conf[FIELDS];
+	unsigned int field_done;
+	long min_dev;
+	long sig_stat[60];
+	long sig_sum;		// sum of sig_stat[]
+	long sig_avr;
+	unsigned int sig_short;
+	unsigned int sig_long;
+	int sig_short_q;
+	int sig_long_q;
+	int64_t pll_freq;	// deviation of the receivers second from 1 sec
+	long pll_err;		// phase error of the last second mark in nsec
+	int pll_lock;
+	int64_t pll_mark;	// CLOCK_MONOTONIC_RAW of the last accepted second mark in nsec
+	int64_t sec_seen;	// start of the last second with mark or pulse in nsec
+	dcf77_time time_last;
+	dcf77_time time_now;
+	time_t data_stamp;
+	int precision;
+	int prec_max;		// best 'precision' the timestamps of the source allow, 0 without limit
+	int frames;
+	int seconds;
+	dcf77_prior prior;	// state before the restart, until the first stamp
+	dcf77_stats stats;
+	event_ring *log;	// event log, NULL if off
+	dcf77_text text;	// of '-D', only with 'debug' set
+
+// results not yet polled
+	dcf77_result res[DECODER_RESULTS];
+	unsigned int res_head;
+	unsigned int res_tail;
+
+// time spent in check_data() if 'bench' is set
+	int bench;
+	int64_t check_ns;
+	uint64_t check_cnt;
+} dcf77_decoder;
+
+void set_time_info (time_info_t *info, const edge_t *edge);
+void init_dcf77_time (dcf77_time *time);
+void init_time_info (time_info_t *info);
+void text_printf (dcf77_text *text, const char *format, ...);
+size_t text_done (dcf77_text *text);
+void output_time (dcf77_text *text, const dcf77_time *time);
+void civil_time (const time_t stamp, dcf77_time *time);
+void add_minute (dcf77_time *dcf, time_info_t *info, const int count);
+void frame_init (dcf77_frame *frame);
+void frame_set (dcf77_frame *frame, const int bit, const int value);
+int frame_get (const dcf77_frame *frame, const int bit);
+void frame_pack (dcf77_frame *frame, const int8_t *data);
+void frame_unpack (const dcf77_frame *frame, int8_t *data);
+int check_field (const dcf77_frame *frame, const int field, dcf77_time *time);
+void frame_expect (dcf77_frame *frame, const time_t stamp);
+void check_data (const dcf77_frame *frame, dcf77_time *now, dcf77_time *last, dcf77_text *text);
+void update_precision (int *precision, const int limit, const long error, dcf77_text *text);
+
+void decoder_init (dcf77_decoder *dec, const long tolerance, const int debug);
+size_t decoder_feed (dcf77_decoder *dec, const edge_t *edge, size_t count);
+int decoder_poll (dcf77_decoder *dec, dcf77_result *res);
+void decoder_stats (const dcf77_decoder *dec, dcf77_stats *stats);
+int decoder_save (const dcf77_decoder *dec, dcf77_prior *prior);
+void decoder_prior (dcf77_decoder *dec, const dcf77_prior *prior, const int64_t now);
+void decoder_limit (dcf77_decoder *dec, const int precision);
+
+#endif
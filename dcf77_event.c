@@ -0,0 +1,228 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * rings of the event log and the thread that writes them.
+ */
+
+#define _GNU_SOURCE		// SCHED_IDLE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "dcf77_event.h"
+
+#define EVENT_BATCH 256
+
+
+
+// called by the producer only, a full ring loses the record
+void event_put (event_ring *ring, const int type, const int64_t mono, const int64_t real, const int a, const int b, const int64_t value) {
+
+	uint32_t head, tail;
+	dcf77_event *rec;
+
+	if (ring == NULL) return;
+
+	head = ring->head;
+	tail = __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE);
+	if (head - tail >= EVENT_RING) {
+		__atomic_store_n (&ring->lost, ring->lost + 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	rec = &ring->rec[head & (EVENT_RING - 1)];
+	rec->mono = mono;
+	rec->real = real;
+	rec->value = value;
+	rec->type = type;
+	rec->source = ring->source;
+	rec->a = a;
+	rec->b = b;
+	__atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+
+// write() on a socket whose reader has gone raises SIGPIPE and kills the daemon
+static ssize_t event_send (const event_log *log, const void *buf, const size_t len) {
+	return log->sock ? send (log->fd, buf, len, MSG_NOSIGNAL) : write (log->fd, buf, len);
+}
+
+
+
+// 'name' is a file, appended to, or 'unix:<socket>' of a listening process
+// an existing file must have the header of this format, a broken last record is cut off
+// return 0 or -1 on error
+int event_open (event_log *log, const char *name) {
+
+	dcf77_event_header header;
+	struct sockaddr_un addr;
+	struct stat st;
+	off_t end;
+
+	memset (log, 0, sizeof (*log));
+
+	if (strncmp (name, "unix:", 5) == 0) {
+		if (strlen (name + 5) >= sizeof (addr.sun_path)) return -1;
+		memset (&addr, 0, sizeof (addr));
+		addr.sun_family = AF_UNIX;
+		strcpy (addr.sun_path, name + 5);
+		if ((log->fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0) return -1;
+		if (connect (log->fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+			close (log->fd);
+			return -1;
+		}
+		log->sock = 1;
+		st.st_size = 0;
+	}
+	else {
+		if ((log->fd = open (name, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0) return -1;
+		if (fstat (log->fd, &st) < 0) {
+			close (log->fd);
+			return -1;
+		}
+	}
+
+	if (st.st_size > 0) {
+		if (lseek (log->fd, 0, SEEK_SET) < 0 || read (log->fd, &header, sizeof (header)) != sizeof (header) || memcmp (header.magic, DCF77_EVENT_MAGIC, sizeof (header.magic))
+			|| header.version != DCF77_EVENT_VERSION || header.record_size != sizeof (dcf77_event)) {
+			fprintf (stderr, "Event log '%s' is not a log of this version, not appended to!\n", name);
+			close (log->fd);
+			return -1;
+		}
+		end = st.st_size - (st.st_size - sizeof (header)) % sizeof (dcf77_event);
+		if (end != st.st_size) {
+			fprintf (stderr, "Event log '%s' has a broken last record, cut off.\n", name);
+			if (ftruncate (log->fd, end) < 0) {
+				close (log->fd);
+				return -1;
+			}
+		}
+	}
+
+// a file that is appended to has its header already
+	if (st.st_size == 0) {
+		memset (&header, 0, sizeof (header));
+		memcpy (header.magic, DCF77_EVENT_MAGIC, sizeof (header.magic));
+		header.version = DCF77_EVENT_VERSION;
+		header.record_size = sizeof (dcf77_event);
+		if (event_send (log, &header, sizeof (header)) != sizeof (header)) {
+			close (log->fd);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+
+// a ring for one producer, before the writer is started
+event_ring *event_ring_add (event_log *log, const int source) {
+
+	event_ring *ring;
+
+	if (log->count >= EVENT_RINGS || (ring = calloc (1, sizeof (*ring))) == NULL) return NULL;
+	ring->source = source;
+	log->ring[log->count++] = ring;
+	return ring;
+}
+
+
+
+// move the records of a ring to the batch, followed by a record of the ones lost since the last time
+static size_t event_drain (event_ring *ring, dcf77_event *batch, const size_t max) {
+
+	uint32_t tail = ring->tail;
+	uint32_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+	uint32_t lost = __atomic_load_n (&ring->lost, __ATOMIC_RELAXED);
+	struct timespec ts;
+	size_t count = 0;
+
+	while (tail != head && count < max - 1) batch[count++] = ring->rec[tail++ & (EVENT_RING - 1)];
+	__atomic_store_n (&ring->tail, tail, __ATOMIC_RELEASE);
+
+	if (lost != ring->lost_last) {
+		memset (&batch[count], 0, sizeof (batch[count]));
+		clock_gettime (CLOCK_MONOTONIC_RAW, &ts);
+		batch[count].mono = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+		clock_gettime (CLOCK_REALTIME, &ts);
+		batch[count].real = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+		batch[count].type = EVENT_LOST;
+		batch[count].source = ring->source;
+		batch[count].value = lost - ring->lost_last;
+		ring->lost_last = lost;
+		count++;
+	}
+
+	return count;
+}
+
+
+
+// return 0 or -1 if the file or socket is gone
+static int event_write (event_log *log) {
+
+	dcf77_event batch[EVENT_BATCH];
+	size_t count, done;
+	ssize_t ret;
+	int i;
+
+	for (i = 0 ; i < log->count ; i++) {
+		while ((count = event_drain (log->ring[i], batch, EVENT_BATCH)) > 0) {
+			for (done = 0 ; done < count * sizeof (dcf77_event) ; done += ret) {
+				ret = event_send (log, (char *) batch + done, count * sizeof (dcf77_event) - done);
+				if (ret < 0 && errno == EINTR) ret = 0;
+				else if (ret <= 0) return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+
+
+static void *event_thread (void *arg) {
+
+	event_log *log = arg;
+	struct timespec ts = { 0, EVENT_PERIOD * 1000000L };
+	struct sched_param param;
+
+// the log must never take time from the receivers
+	memset (&param, 0, sizeof (param));
+	pthread_setschedparam (pthread_self (), SCHED_IDLE, &param);
+
+	while (__atomic_load_n (&log->run, __ATOMIC_RELAXED)) {
+		if (event_write (log) < 0) break;
+		nanosleep (&ts, NULL);
+	}
+	event_write (log);
+
+	return NULL;
+}
+
+
+
+int event_start (event_log *log) {
+	log->run = 1;
+	return pthread_create (&log->thread, NULL, event_thread, log) ? -1 : 0;
+}
+
+
+
+// write what is left and close
+void event_stop (event_log *log) {
+	__atomic_store_n (&log->run, 0, __ATOMIC_RELAXED);
+	pthread_join (log->thread, NULL);
+	close (log->fd);
+}
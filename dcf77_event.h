@@ -0,0 +1,77 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * event log, compact binary records of what the decoders and the output do.
+ *
+ * Every producer (a decoder or the output) has its own preallocated ring
+ * and never blocks: when the ring is full the record is counted as lost.
+ * A writer thread at idle priority drains the rings to a file or socket,
+ * 'dcf77_render' turns the records back into text.
+ * All values are in host byte order.
+ */
+
+#ifndef DCF77_EVENT_H
+#define DCF77_EVENT_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define DCF77_EVENT_MAGIC   "DCF77EVT"
+#define DCF77_EVENT_VERSION 1
+
+#define EVENT_RING    4096	// records per producer, a power of two
+#define EVENT_RINGS   8
+#define EVENT_PERIOD  100	// the writer drains the rings every 100 msec
+#define EVENT_OUTPUT  255	// source of the records of the output
+
+#define EVENT_EDGE    1		// a: level, b: pin
+#define EVENT_SYNC    2		// a: direction of the first edge found, 0 while syncing
+#define EVENT_MARK    3		// second mark, a: second (-1 unknown), b: signal in percent, value: deviation in nsec
+#define EVENT_PULSE   4		// a: bit, b: signal in percent, value: deviation from the average in nsec
+#define EVENT_NOISE   5		// value: deviation in nsec
+#define EVENT_RESYNC  6		// minute start lost, search for a new one
+#define EVENT_MINUTE  7		// a: stamp_chk, b: bit errors (-1 unknown), value: stamp
+#define EVENT_SAMPLE  8		// sample to SHM or chrony, a: second (0 for the minute), b: leap, value: offset in nsec
+#define EVENT_LOST    9		// value: records lost in the ring of the source
+
+typedef struct {
+	int64_t mono;		// CLOCK_MONOTONIC_RAW in ns, of the edge that caused the record
+	int64_t real;		// CLOCK_REALTIME in ns
+	int64_t value;
+	uint8_t type;
+	uint8_t source;		// receiver or EVENT_OUTPUT
+	int16_t a;
+	int32_t b;
+} dcf77_event;
+
+typedef struct {
+	char     magic[8];		// DCF77_EVENT_MAGIC without '\0'
+	uint32_t version;		// DCF77_EVENT_VERSION
+	uint32_t record_size;	// sizeof (dcf77_event)
+} dcf77_event_header;
+
+// single producer, single consumer, like the edge queues
+typedef struct {
+	dcf77_event rec[EVENT_RING];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t lost;
+	uint32_t lost_last;		// of the writer
+	int source;
+} event_ring;
+
+typedef struct {
+	event_ring *ring[EVENT_RINGS];
+	int count;
+	int fd;
+	int sock;		// fd is a socket, a reader that goes away must not raise SIGPIPE
+	int run;
+	pthread_t thread;
+} event_log;
+
+void event_put (event_ring *ring, const int type, const int64_t mono, const int64_t real, const int a, const int b, const int64_t value);
+int event_open (event_log *log, const char *name);
+event_ring *event_ring_add (event_log *log, const int source);
+int event_start (event_log *log);
+void event_stop (event_log *log);
+
+#endif
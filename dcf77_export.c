@@ -0,0 +1,192 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * read the metrics page of 'dcf77_clock -m' and write a Prometheus textfile,
+ * e.g. for the textfile collector of the node exporter.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/types.h>
+
+#include "dcf77_metrics.h"
+
+#define EXPORT_INT  0
+#define EXPORT_NSEC 1	// written in seconds
+
+typedef struct {
+	const char *name;
+	const char *type;
+	const char *help;
+	size_t offset;
+	int size;
+	int unit;
+} export_t;
+
+#define EXPORT(field, name, type, unit, help) { name, type, help, offsetof (dcf77_metric, field), sizeof (((dcf77_metric *) 0)->field), unit }
+
+static const export_t export_table[] = {
+	EXPORT (edges,     "dcf77_edges_total",          "counter", EXPORT_INT,  "Edges fed to the decoder."),
+	EXPORT (noise,     "dcf77_noise_edges_total",    "counter", EXPORT_INT,  "Edges that are neither second mark nor pulse."),
+	EXPORT (marks,     "dcf77_second_marks_total",   "counter", EXPORT_INT,  "Second marks."),
+	EXPORT (minutes,   "dcf77_minute_marks_total",   "counter", EXPORT_INT,  "Minute marks."),
+	EXPORT (resyncs,   "dcf77_resyncs_total",        "counter", EXPORT_INT,  "Searches for a new minute start."),
+	EXPORT (bit_cnt,   "dcf77_bits_checked_total",   "counter", EXPORT_INT,  "Bits compared with the predicted frame."),
+	EXPORT (bit_err,   "dcf77_bit_errors_total",     "counter", EXPORT_INT,  "Bits that differ from the predicted frame."),
+	EXPORT (stamp,     "dcf77_stamp_seconds",        "gauge",   EXPORT_INT,  "Start of the last decoded minute, 0 if not synced."),
+	EXPORT (stamp_chk, "dcf77_stamp_confirm",        "gauge",   EXPORT_INT,  "Confirmation count of the stamp."),
+	EXPORT (precision, "dcf77_precision_log2",       "gauge",   EXPORT_INT,  "Precision as power of two, as given to ntpd."),
+	EXPORT (min_dev,   "dcf77_minute_dev_seconds",   "gauge",   EXPORT_NSEC, "Average deviation of the minute marks."),
+	EXPORT (sig_avr,   "dcf77_signal_dev_seconds",   "gauge",   EXPORT_NSEC, "Average deviation of the pulses."),
+	EXPORT (updated,   "dcf77_last_update_seconds",  "gauge",   EXPORT_NSEC, "Time of the last update by the receiver.")
+};
+
+#define EXPORTS (sizeof (export_table) / sizeof (export_table[0]))
+
+static const char *field_name[STATS_FIELDS] = { "minute", "hour", "date" };
+
+
+
+static int64_t export_value (const dcf77_metric *m, const export_t *ex) {
+
+	const char *p = (const char *) m + ex->offset;
+
+	switch (ex->size) {
+		case 4: return *(const int32_t *) p;
+		case 8: return *(const int64_t *) p;
+	}
+	return 0;
+}
+
+
+
+// write all receivers to 'out', return 0 or -1 on error
+static int export_write (FILE *out, const dcf77_metrics *metrics) {
+
+	dcf77_metric m[METRICS_SLOTS];
+	int stale[METRICS_SLOTS];
+	unsigned int i, j;
+	int64_t value;
+
+// a slot that stays busy is left out of the values and only reported as stale
+	for (i = 0 ; i < METRICS_SLOTS ; i++) {
+		stale[i] = metrics_read (&metrics->rcv[i], &m[i]) < 0;
+		if (stale[i]) m[i].active = 0;
+	}
+
+	fprintf (out, "# HELP dcf77_up The daemon that writes the metrics is running.\n");
+	fprintf (out, "# TYPE dcf77_up gauge\n");
+	fprintf (out, "dcf77_up %d\n", metrics->pid > 0 && (kill (metrics->pid, 0) == 0 || errno == EPERM));
+
+	fprintf (out, "# HELP dcf77_stale The slot of the receiver could not be read, it stayed busy.\n");
+	fprintf (out, "# TYPE dcf77_stale gauge\n");
+	for (i = 0 ; i < METRICS_SLOTS ; i++) {
+		if (m[i].active || stale[i]) fprintf (out, "dcf77_stale{receiver=\"%u\"} %d\n", i, stale[i]);
+	}
+
+	for (j = 0 ; j < EXPORTS ; j++) {
+		fprintf (out, "# HELP %s %s\n", export_table[j].name, export_table[j].help);
+		fprintf (out, "# TYPE %s %s\n", export_table[j].name, export_table[j].type);
+		for (i = 0 ; i < METRICS_SLOTS ; i++) {
+			if (m[i].active == 0) continue;
+			value = export_value (&m[i], &export_table[j]);
+			if (export_table[j].unit == EXPORT_NSEC) fprintf (out, "%s{receiver=\"%u\"} %.9lf\n", export_table[j].name, i, 0.000000001 * value);
+			else if (strcmp (export_table[j].type, "counter") == 0) fprintf (out, "%s{receiver=\"%u\"} %llu\n", export_table[j].name, i, (unsigned long long) value);
+			else fprintf (out, "%s{receiver=\"%u\"} %lld\n", export_table[j].name, i, (long long) value);
+		}
+	}
+
+	fprintf (out, "# HELP dcf77_parity_errors_total Minutes with a failed parity of a field.\n");
+	fprintf (out, "# TYPE dcf77_parity_errors_total counter\n");
+	for (i = 0 ; i < METRICS_SLOTS ; i++) {
+		if (m[i].active == 0) continue;
+		for (j = 0 ; j < STATS_FIELDS ; j++) {
+			fprintf (out, "dcf77_parity_errors_total{receiver=\"%u\",field=\"%s\"} %llu\n", i, field_name[j], (unsigned long long) m[i].parity[j]);
+		}
+	}
+
+	return ferror (out) ? -1 : 0;
+}
+
+
+
+int main (int argc, char *argv[])
+{
+
+	const dcf77_metrics *metrics;
+	char metrics_name[256] = "", text_name[256] = "", tmp_name[300];
+	unsigned int interval = 15;
+	FILE *out;
+	int i;
+
+	while ((i = getopt (argc, argv, "hm:o:i:")) != -1) {
+		switch (i) {
+
+			case 'h':
+				fprintf (stderr, "Usage: %s [-h] -m <file> [-o <textfile>] [-i <sec>]\n", argv[0]);
+				fprintf (stderr, "    -h          this helptext\n");
+				fprintf (stderr, "    -m <file>   metrics file of 'dcf77_clock -m'\n");
+				fprintf (stderr, "    -o <file>   textfile to write, replaced atomically (default: stdout)\n");
+				fprintf (stderr, "    -i <sec>    write every <sec> seconds, 0 to write once (default: 15)\n");
+				return EXIT_FAILURE;
+
+			case 'm':
+				strncpy (metrics_name, optarg, 255);
+				break;
+
+			case 'o':
+				strncpy (text_name, optarg, 255);
+				break;
+
+			case 'i':
+				interval = atoi (optarg);
+				break;
+
+			default:
+				fprintf(stderr, "See '%s -h' for more information.\n", argv[0]);
+				return EXIT_FAILURE;
+
+		}
+	}
+
+	if (metrics_name[0] == '\0') {
+		fprintf (stderr, "no metrics file given! exit.\n");
+		return EXIT_FAILURE;
+	}
+
+	if ((metrics = metrics_map (metrics_name, 0)) == NULL) {
+		fprintf (stderr, "Can't map metrics file '%s'! exit.\n", metrics_name);
+		return EXIT_FAILURE;
+	}
+
+	if (text_name[0] == '\0') interval = 0;
+	snprintf (tmp_name, sizeof (tmp_name), "%s.tmp", text_name);
+
+	while (1) {
+
+// the collector must never see a half written file
+		if (text_name[0] == '\0') export_write (stdout, metrics);
+		else if ((out = fopen (tmp_name, "w")) == NULL) {
+			fprintf (stderr, "Can't write '%s'!\n", tmp_name);
+		}
+		else {
+			i = export_write (out, metrics);
+			if (fclose (out) != 0 || i < 0 || rename (tmp_name, text_name) < 0) {
+				fprintf (stderr, "Can't write '%s'!\n", text_name);
+				unlink (tmp_name);
+			}
+		}
+
+		if (interval == 0) break;
+		sleep (interval);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * fusion of several receivers into one minute by weighted majority per bit.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "dcf77_fusion.h"
+
+
+
+static int64_t time_ns (const struct timespec *ts) {
+	return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+
+
+void fusion_init (dcf77_fusion *fus, const int receivers, const int debug) {
+
+	int i;
+
+	memset (fus, 0, sizeof (*fus));
+
+	fus->receivers = receivers;
+	fus->debug = debug;
+	fus->precision = 5 * 16;
+	for (i = 0 ; i < RECEIVER_MAX ; i++) fus->weight[i] = 50;
+
+	init_time_info (&fus->min_last);
+	init_dcf77_time (&fus->time_last);
+	init_dcf77_time (&fus->time_now);
+}
+
+
+
+static dcf77_result *fusion_result (dcf77_fusion *fus, const int type) {
+
+	dcf77_result *res = &fus->res[fus->res_head % DECODER_RESULTS];
+
+	fus->res_head++;
+	if (fus->res_head - fus->res_tail > DECODER_RESULTS) fus->res_tail++;
+
+	memset (res, 0, sizeof (*res));
+	res->type = type;
+	return res;
+}
+
+
+
+// decide every bit of the collected minute and decode it
+static void fusion_publish (dcf77_fusion *fus) {
+
+	dcf77_result *res;
+	dcf77_frame frame;
+	int64_t gap;
+	int i, first;
+
+	if (fus->pending == 0) return;
+	fus->pending = 0;
+
+	frame_init (&frame);
+	for (i = 0 ; i < 60 ; i++) {
+		if (fus->vote[i]) frame_set (&frame, i, fus->vote[i] > 0);
+	}
+
+	if (fus->debug) {
+		text_printf (&fus->text, "Fusion of receivers 0x%02x:\n", fus->have);
+		for (i = 0 ; i < 60 ; i++) {
+			if ((i % 10) == 0) text_printf (&fus->text, "%02d: ", i);
+			text_printf (&fus->text, "%2d ", frame_get (&frame, i));
+			if ((i % 10) == 9) text_printf (&fus->text, "\n");
+			else text_printf (&fus->text, " ");
+		}
+	}
+
+// follow the minutes without a fused frame, start over after more then two
+	if (fus->min_last.time.tv_sec) {
+		gap = (time_ns (&fus->edge.time) - time_ns (&fus->min_last.time) + 30000000000LL) / 60000000000LL;
+		if (gap > 3) {
+			if (fus->debug) text_printf (&fus->text, "Fusion lost %d minutes, start over.\n", (int) gap - 1);
+			init_dcf77_time (&fus->time_last);
+		}
+		else if (gap > 1) {
+			add_minute (&fus->time_last, &fus->min_last, gap - 1);
+		}
+	}
+
+// bits 1 to 14 belong to the minute that ends now
+	if (fus->time_last.stamp && fus->time_last.tz > 0 && fus->time_last.wday > 0) {
+		res = fusion_result (fus, RESULT_DATA);
+		res->time = fus->time_last;
+		frame_unpack (&frame, res->data);
+	}
+
+	check_data (&frame, &fus->time_now, &fus->time_last, fus->debug ? &fus->text : NULL);
+
+	first = fus->time_last.stamp == 0 && fus->time_now.stamp;
+	if (fus->time_now.stamp) update_precision (&fus->precision, 0, fus->residual, fus->debug ? &fus->text : NULL);
+
+	res = fusion_result (fus, RESULT_MINUTE);
+	res->time = fus->time_now;
+	res->edge = fus->edge;
+	res->mark = fus->mark;
+	res->residual = fus->residual;
+	res->first = first;
+	res->min_dev = fus->min_dev;
+	res->sig_avr = fus->sig_avr;
+	res->precision = -(fus->precision >> 4);
+
+	if (fus->debug) {
+		text_printf (&fus->text, "--- Fused ---\n");
+		output_time (&fus->text, &fus->time_now);
+	}
+
+	fus->time_last = fus->time_now;
+	fus->min_last = fus->edge;
+	init_dcf77_time (&fus->time_now);
+}
+
+
+
+// add the bits of one receiver to the minute, weighted by the confidence of bit and receiver
+void fusion_frame (dcf77_fusion *fus, const int receiver, const dcf77_result *frame) {
+
+	int64_t edge = time_ns (&frame->edge.time);
+	int i, known = 0, sum = 0;
+
+	if (receiver < 0 || receiver >= RECEIVER_MAX) return;
+
+	if (fus->pending && (edge - fus->first > FUSION_WINDOW || fus->first - edge > FUSION_WINDOW || (fus->have & (1 << receiver))))
+		fusion_publish (fus);
+
+	if (fus->pending == 0) {
+		memset (fus->vote, 0, sizeof (fus->vote));
+		fus->have = 0;
+		fus->best = -1;
+		fus->first = edge;
+		fus->pending = 1;
+	}
+
+	for (i = 0 ; i < 60 ; i++) {
+		if (frame->data[i] < 0) continue;
+		fus->vote[i] += (long) fus->weight[receiver] * frame->conf[i] * (frame->data[i] ? 1 : -1);
+		sum += frame->conf[i];
+		known++;
+	}
+
+// the time of the minute marker and its deviations come from the most trusted receiver
+	if (fus->weight[receiver] > fus->best) {
+		fus->best = fus->weight[receiver];
+		fus->edge = frame->edge;
+		fus->mark = frame->mark;
+		fus->residual = frame->residual;
+		fus->min_dev = frame->min_dev;
+		fus->sig_avr = frame->sig_avr;
+	}
+
+// missing bits count as zero confidence (59 bits carry data)
+	fus->weight[receiver] = (fus->weight[receiver] * 7 + (known ? sum / 59 : 0)) / 8;
+	if (fus->weight[receiver] < 1) fus->weight[receiver] = 1;
+
+	if (fus->debug) text_printf (&fus->text, "Receiver %d: %d bits, weight %d\n", receiver, known, fus->weight[receiver]);
+
+	fus->have |= 1 << receiver;
+	if (fus->have == (1U << fus->receivers) - 1) fusion_publish (fus);
+}
+
+
+
+// a second mark of the most trusted receiver, with the time of the last fused minute
+void fusion_second (dcf77_fusion *fus, const int receiver, const dcf77_result *second) {
+
+	dcf77_result *res;
+	int64_t sec;
+	int i;
+
+	if (receiver < 0 || receiver >= RECEIVER_MAX || fus->time_last.stamp == 0 || fus->min_last.time.tv_sec == 0) return;
+	for (i = 0 ; i < fus->receivers ; i++) {
+		if (fus->weight[i] > fus->weight[receiver]) return;
+	}
+
+// a minute that is collected right now is not yet in 'time_last'
+	sec = (time_ns (&second->mark.time) - time_ns (&fus->min_last.time) + 500000000LL) / 1000000000LL;
+	if (sec < 1 || sec > 59) return;
+
+	if (fus->res_head != fus->res_tail && fus->res[(fus->res_head - 1) % DECODER_RESULTS].type == RESULT_SECOND) fus->res_head--;
+	res = fusion_result (fus, RESULT_SECOND);
+	res->time = fus->time_last;
+	res->time.stamp += sec;
+	res->second = sec;
+	res->edge = second->edge;
+	res->mark = second->mark;
+	res->residual = second->residual;
+	res->precision = -(fus->precision >> 4);
+}
+
+
+
+// CLOCK_MONOTONIC_RAW in ns when the pending minute has to be published, 0 if none
+int64_t fusion_deadline (const dcf77_fusion *fus) {
+	return fus->pending ? fus->first + FUSION_WAIT : 0;
+}
+
+
+
+void fusion_timeout (dcf77_fusion *fus, const int64_t now) {
+	if (fus->pending && now >= fus->first + FUSION_WAIT) fusion_publish (fus);
+}
+
+
+
+int fusion_poll (dcf77_fusion *fus, dcf77_result *res) {
+
+	if (fus->res_tail == fus->res_head) return 0;
+
+	*res = fus->res[fus->res_tail % DECODER_RESULTS];
+	fus->res_tail++;
+	return 1;
+}
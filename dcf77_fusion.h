@@ -0,0 +1,56 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * fusion of several receivers into one minute by weighted majority per bit.
+ */
+
+#ifndef DCF77_FUSION_H
+#define DCF77_FUSION_H
+
+#include <stdint.h>
+
+#include "dcf77_decoder.h"
+
+// frames of different receivers with minute markers closer then this belong to the same minute
+#define FUSION_WINDOW 2000000000LL
+// publish a minute this long after the first frame, even if receivers are missing
+#define FUSION_WAIT   1500000000LL
+
+typedef struct {
+	int receivers;
+	int debug;
+
+// recent confidence of every receiver in percent, the weight of its votes
+	int weight[RECEIVER_MAX];
+
+// the minute that is collected right now
+	int pending;
+	unsigned int have;	// bit mask of the receivers
+	time_info_t edge;	// minute marker of the best receiver
+	time_info_t mark;
+	long residual;
+	int64_t first;		// CLOCK_MONOTONIC_RAW of the first frame in ns
+	long vote[60];		// > 0 for one, < 0 for zero
+	int best;			// weight of the receiver that delivered 'edge'
+	long min_dev;
+	long sig_avr;
+
+// decoding of the fused minutes
+	time_info_t min_last;
+	dcf77_time time_last;
+	dcf77_time time_now;
+	int precision;
+	dcf77_text text;	// of '-D', taken by the output
+
+	dcf77_result res[DECODER_RESULTS];
+	unsigned int res_head;
+	unsigned int res_tail;
+} dcf77_fusion;
+
+void fusion_init (dcf77_fusion *fus, const int receivers, const int debug);
+void fusion_frame (dcf77_fusion *fus, const int receiver, const dcf77_result *frame);
+void fusion_second (dcf77_fusion *fus, const int receiver, const dcf77_result *second);
+int64_t fusion_deadline (const dcf77_fusion *fus);
+void fusion_timeout (dcf77_fusion *fus, const int64_t now);
+int fusion_poll (dcf77_fusion *fus, dcf77_result *res);
+
+#endif
@@ -0,0 +1,328 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * write a synthetic DCF77 signal to a trace file for replay with 'dcf77_clock -r',
+ * or the amplitude modulated carrier to a WAV file for 'dcf77_clock -S pcm:<file>'.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+
+#include "dcf77_trace.h"
+#include "dcf77_signal.h"
+#include "dcf77_pcm.h"
+
+#define GEN_BATCH 1024
+#define GEN_WAV   4096		// samples written at once
+#define GEN_DROP  0.15		// amplitude of the carrier during a pulse
+#define GEN_PM    15.6		// deviation of the phase modulation (degree)
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+	int fd;
+	int rate;
+	double freq;
+	double noise;			// of the carrier amplitude
+	double phase;
+	double drift;			// ppm, like the edges
+	int pm;					// phase modulation on
+	int8_t chip[PCM_PM_CHIPS];
+	int64_t rise;			// last start of a pulse
+	int bit;				// of the last pulse, inverts the sequence
+	int level;
+	uint64_t rng;
+	int64_t sample;			// samples written
+	int16_t buf[GEN_WAV];
+	size_t fill;
+} wav_t;
+
+
+
+static void put_le (uint8_t *p, uint32_t value, int len) {
+	while (len-- > 0) {
+		*p++ = value & 0xff;
+		value >>= 8;
+	}
+}
+
+
+
+// uniform in -1 .. 1, xorshift64* like the signal
+static double wav_random (wav_t *wav) {
+	wav->rng ^= wav->rng >> 12;
+	wav->rng ^= wav->rng << 25;
+	wav->rng ^= wav->rng >> 27;
+	return ((wav->rng * 2685821657736338717ULL) >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+
+
+// header of 16 bit mono PCM, written again with the sizes at the end
+static int wav_header (wav_t *wav) {
+
+	uint8_t head[44];
+	uint32_t size = wav->sample * 2;
+
+	memcpy (head, "RIFF", 4);
+	put_le (head + 4, 36 + size, 4);
+	memcpy (head + 8, "WAVEfmt ", 8);
+	put_le (head + 16, 16, 4);
+	put_le (head + 20, 1, 2);
+	put_le (head + 22, 1, 2);
+	put_le (head + 24, wav->rate, 4);
+	put_le (head + 28, wav->rate * 2, 4);
+	put_le (head + 32, 2, 2);
+	put_le (head + 34, 16, 2);
+	memcpy (head + 36, "data", 4);
+	put_le (head + 40, size, 4);
+
+	if (lseek (wav->fd, 0, SEEK_SET) < 0 || write (wav->fd, head, sizeof (head)) != sizeof (head)) return -1;
+	return lseek (wav->fd, 0, SEEK_END) < 0 ? -1 : 0;
+}
+
+
+
+static int wav_flush (wav_t *wav) {
+
+	uint8_t out[GEN_WAV * 2];
+	size_t i;
+
+	for (i = 0 ; i < wav->fill ; i++) put_le (out + 2 * i, (uint16_t) wav->buf[i], 2);
+	if (write (wav->fd, out, wav->fill * 2) != (ssize_t) (wav->fill * 2)) return -1;
+	wav->fill = 0;
+	return 0;
+}
+
+
+
+// the carrier up to 'time' (nsec after the start), with the amplitude of the last level
+static int wav_until (wav_t *wav, const int64_t time) {
+
+	const int64_t end = time * wav->rate / 1000000000LL;
+	const double amp = (wav->level ? GEN_DROP : 1.0) * 10000.0;
+	double noise, sec, shift;
+	int chip;
+
+	for ( ; wav->sample < end ; wav->sample++) {
+// the sequence runs on the time of the transmitter, without the jitter of the edges
+		shift = 0.0;
+		if (wav->pm) {
+			sec = (double) wav->sample / wav->rate / (1.0 + wav->drift * 1e-6);
+			chip = (int) ((sec - floor (sec) - PCM_PM_START) / PCM_PM_CHIP);
+			if (sec - floor (sec) >= PCM_PM_START && chip < PCM_PM_CHIPS) shift = (wav->chip[chip] ^ wav->bit ? -GEN_PM : GEN_PM) * M_PI / 180.0;
+		}
+// about gaussian, sum of uniform values
+		noise = (wav_random (wav) + wav_random (wav) + wav_random (wav)) * wav->noise * 10000.0;
+		wav->buf[wav->fill++] = (int16_t) (amp * sin (wav->phase + shift) + noise);
+		wav->phase += 2.0 * M_PI * wav->freq / wav->rate;
+		if (wav->phase > 2.0 * M_PI) wav->phase -= 2.0 * M_PI;
+		if (wav->fill == GEN_WAV && wav_flush (wav) < 0) return -1;
+	}
+	return 0;
+}
+
+
+
+int main (int argc, char *argv[])
+{
+
+	signal_config_t cfg;
+	signal_t sig;
+	static edge_t edge[GEN_BATCH];
+	char trace_name[256] = "", wav_name[256] = "";
+	wav_t wav;
+	size_t count, total = 0, n;
+	int fd = -1, i, pins = 0;
+
+	memset (&cfg, 0, sizeof (cfg));
+	cfg.start = time (NULL);
+	cfg.end = cfg.start + 3600;
+	cfg.pin[0] = 0;
+	cfg.pin[1] = -1;
+	cfg.mono = 1000000000000LL;
+	memset (&wav, 0, sizeof (wav));
+	wav.fd = -1;
+	wav.rate = 8000;
+	wav.freq = 1000;
+
+	while ((i = getopt (argc, argv, "hs:e:o:j:d:n:c:l:g:iw:x:a:r:f:q:p")) != -1) {
+		switch (i) {
+
+			case 'h':
+				fprintf (stderr, "Usage: %s [-h] -o <trace> [-s <time>] [-e <time>] [-j <msec>] [-d <prob>] [-n <rate>] [-c <ppm>] [-l <time>] [-g <pin>] [-i] [-w <bits>] [-x <seed>] [-a <wav>] [-r <rate>] [-f <hz>] [-q <noise>] [-p]\n", argv[0]);
+				fprintf (stderr, "    -h          this helptext\n");
+				fprintf (stderr, "    -o <trace>  trace file to write (appended if it exists)\n");
+				fprintf (stderr, "    -s <time>   first minute in seconds since epoch (default: now)\n");
+				fprintf (stderr, "    -e <time>   end in seconds since epoch (default: start + 1 hour)\n");
+				fprintf (stderr, "    -j <msec>   standard deviation of the edges in milliseconds (default: 0)\n");
+				fprintf (stderr, "    -d <prob>   probability of a lost edge, 0 to 1 (default: 0)\n");
+				fprintf (stderr, "    -n <rate>   spurious pulses per second (default: 0)\n");
+				fprintf (stderr, "    -c <ppm>    frequency error of the receiver clock (default: 0)\n");
+				fprintf (stderr, "    -l <time>   insert a leap second before this minute (seconds since epoch)\n");
+				fprintf (stderr, "    -g <pin>    pin number to record (default: 0), give it twice for inverted output\n");
+				fprintf (stderr, "    -i          inverted output on pin + 1, like '-g <pin> -g <pin+1>'\n");
+				fprintf (stderr, "    -w <bits>   value of bit 1 to 14 (default: 0)\n");
+				fprintf (stderr, "    -x <seed>   random seed (default: fixed)\n");
+				fprintf (stderr, "    -a <wav>    WAV file of the carrier to write, of the first pin (with or without '-o')\n");
+				fprintf (stderr, "    -r <rate>   sample rate of the WAV file (default: 8000)\n");
+				fprintf (stderr, "    -f <hz>     frequency of the carrier in the WAV file (default: 1000)\n");
+				fprintf (stderr, "    -q <noise>  noise of the WAV file, of the carrier amplitude (default: 0)\n");
+				fprintf (stderr, "    -p          phase modulation with the pseudo-random sequence in the WAV file\n");
+				return EXIT_FAILURE;
+
+			case 'o':
+				strncpy (trace_name, optarg, 255);
+				break;
+
+			case 's':
+				cfg.start = strtoll (optarg, NULL, 10);
+				break;
+
+			case 'e':
+				cfg.end = strtoll (optarg, NULL, 10);
+				break;
+
+			case 'j':
+				cfg.jitter = strtod (optarg, NULL) * 1000000.0;
+				break;
+
+			case 'd':
+				cfg.dropout = strtod (optarg, NULL);
+				break;
+
+			case 'n':
+				cfg.glitch = strtod (optarg, NULL);
+				break;
+
+			case 'c':
+				cfg.drift = strtod (optarg, NULL);
+				break;
+
+			case 'l':
+				cfg.leap = strtoll (optarg, NULL, 10);
+				if (cfg.leap % 60) {
+					fprintf (stderr, "Leap second must be at the start of a minute! exit.\n");
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 'g':
+				cfg.pin[pins ? 1 : 0] = atoi (optarg);
+				pins++;
+				break;
+
+			case 'i':
+				cfg.pin[1] = cfg.pin[0] + 1;
+				break;
+
+			case 'w':
+				cfg.weather = strtol (optarg, NULL, 0) & 0x3fff;
+				break;
+
+			case 'x':
+				cfg.seed = strtoull (optarg, NULL, 0);
+				break;
+
+			case 'a':
+				strncpy (wav_name, optarg, 255);
+				break;
+
+			case 'r':
+				wav.rate = atoi (optarg);
+				break;
+
+			case 'f':
+				wav.freq = strtod (optarg, NULL);
+				break;
+
+			case 'q':
+				wav.noise = strtod (optarg, NULL);
+				break;
+
+			case 'p':
+				wav.pm = 1;
+				break;
+
+			default:
+				fprintf(stderr, "See '%s -h' for more information.\n", argv[0]);
+				return EXIT_FAILURE;
+
+		}
+	}
+
+	if (trace_name[0] == '\0' && wav_name[0] == '\0') {
+		fprintf (stderr, "no trace or WAV file given! exit.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (wav.rate < 1000 || wav.freq <= 0 || wav.freq >= wav.rate / 2) {
+		fprintf (stderr, "Carrier must be below half the sample rate! exit.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (cfg.end <= cfg.start) {
+		fprintf (stderr, "End is before start! exit.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (trace_name[0] && (fd = trace_open (trace_name)) < 0) {
+		fprintf (stderr, "Can't open trace '%s'! exit.\n", trace_name);
+		return EXIT_FAILURE;
+	}
+
+	if (wav_name[0] && ((wav.fd = open (wav_name, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0 || wav_header (&wav) < 0)) {
+		fprintf (stderr, "Can't open WAV file '%s'! exit.\n", wav_name);
+		return EXIT_FAILURE;
+	}
+
+	signal_init (&sig, &cfg);
+	wav.drift = cfg.drift;
+	pcm_chips (wav.chip);
+	wav.rng = cfg.seed ? ~cfg.seed : 0x2545f4914f6cdd1dULL;
+
+	while ((count = signal_edges (&sig, edge, GEN_BATCH)) > 0) {
+		if (fd >= 0 && trace_write (fd, edge, count) < 0) {
+			fprintf (stderr, "Can't write trace '%s'! exit.\n", trace_name);
+			close (fd);
+			return EXIT_FAILURE;
+		}
+		for (n = 0 ; wav.fd >= 0 && n < count ; n++) {
+			if (edge[n].pin != cfg.pin[0]) continue;
+			if (wav_until (&wav, edge[n].mono - cfg.mono) < 0) {
+				fprintf (stderr, "Can't write WAV file '%s'! exit.\n", wav_name);
+				close (wav.fd);
+				return EXIT_FAILURE;
+			}
+			wav.level = edge[n].level;
+			if (wav.level) wav.rise = edge[n].mono;
+			else wav.bit = edge[n].mono - wav.rise > 150000000LL;
+		}
+		total += count;
+	}
+
+	if (fd >= 0) close (fd);
+	fprintf (stderr, "%zu edges written.\n", total);
+
+	if (wav.fd >= 0) {
+// one second of carrier after the last edge
+		if (wav_until (&wav, (wav.sample + wav.rate) * 1000000000LL / wav.rate) < 0 || wav_flush (&wav) < 0 || wav_header (&wav) < 0) {
+			fprintf (stderr, "Can't write WAV file '%s'! exit.\n", wav_name);
+			close (wav.fd);
+			return EXIT_FAILURE;
+		}
+		close (wav.fd);
+		fprintf (stderr, "%lld samples written.\n", (long long) wav.sample);
+	}
+
+	return EXIT_SUCCESS;
+}
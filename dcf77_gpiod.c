@@ -0,0 +1,196 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * edges with kernel timestamps from the GPIO character device (libgpiod v2).
+ *
+ * The kernel stamps every edge in the interrupt handler with CLOCK_MONOTONIC,
+ * so the latency of the reading thread does not end up in the timestamps.
+ * Works with every gpiochip, e.g. 'gpio-sim' or 'gpio-mockup' on a Linux box.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <gpiod.h>
+
+#include "dcf77_gpiod.h"
+#include "dcf77_source.h"
+
+
+
+static int64_t clock_ns (const clockid_t clock) {
+
+	struct timespec ts;
+
+	clock_gettime (clock, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+
+// request one line (both edges) or a line with its inverted output (rising edges only)
+// with pull up and an optional debounce in usec, return 0 or -1 on error
+int chardev_open (chardev_lines *lines, const char *chip, const int *pin, const unsigned long debounce) {
+
+	struct gpiod_line_settings *settings = NULL;
+	struct gpiod_line_config *line_cfg = NULL;
+	struct gpiod_request_config *req_cfg = NULL;
+	unsigned int offset[2];
+	size_t count = 0;
+
+	memset (lines, 0, sizeof (*lines));
+	lines->pin[0] = pin[0];
+	lines->pin[1] = pin[1];
+
+	offset[count++] = pin[0];
+	if (pin[1] >= 0) offset[count++] = pin[1];
+
+	if ((lines->chip = gpiod_chip_open (chip)) == NULL) goto fail;
+	if ((lines->buffer = gpiod_edge_event_buffer_new (CHARDEV_EVENTS)) == NULL) goto fail;
+
+	if ((settings = gpiod_line_settings_new ()) == NULL) goto fail;
+	gpiod_line_settings_set_direction (settings, GPIOD_LINE_DIRECTION_INPUT);
+	gpiod_line_settings_set_edge_detection (settings, count > 1 ? GPIOD_LINE_EDGE_RISING : GPIOD_LINE_EDGE_BOTH);
+	gpiod_line_settings_set_bias (settings, GPIOD_LINE_BIAS_PULL_UP);
+	gpiod_line_settings_set_event_clock (settings, GPIOD_LINE_CLOCK_MONOTONIC);
+	if (debounce) gpiod_line_settings_set_debounce_period_us (settings, debounce);
+
+	if ((line_cfg = gpiod_line_config_new ()) == NULL) goto fail;
+	if (gpiod_line_config_add_line_settings (line_cfg, offset, count, settings) < 0) goto fail;
+
+	if ((req_cfg = gpiod_request_config_new ()) == NULL) goto fail;
+	gpiod_request_config_set_consumer (req_cfg, "dcf77_clock");
+	gpiod_request_config_set_event_buffer_size (req_cfg, CHARDEV_EVENTS);
+
+	lines->request = gpiod_chip_request_lines (lines->chip, req_cfg, line_cfg);
+
+fail:
+	if (req_cfg) gpiod_request_config_free (req_cfg);
+	if (line_cfg) gpiod_line_config_free (line_cfg);
+	if (settings) gpiod_line_settings_free (settings);
+
+	if (lines->request == NULL) {
+		chardev_close (lines);
+		return -1;
+	}
+	return 0;
+}
+
+
+
+// wait up to 'timeout' msec for edges and read them in one batch, 'idx' gets the pin index of every edge
+// (1 for the inverted line), routed by the line offset: the pin of the edge only holds offsets up to 127
+// return the number of edges, 0 on timeout or -1 on error
+int chardev_read (chardev_lines *lines, edge_t *edge, int *idx, const size_t max, const int timeout) {
+
+	struct gpiod_edge_event *event;
+	int64_t raw, mono, real;
+	unsigned int offset;
+	int ret, i;
+
+	ret = gpiod_line_request_wait_edge_events (lines->request, timeout * 1000000LL);
+	if (ret <= 0) return ret;
+
+	ret = gpiod_line_request_read_edge_events (lines->request, lines->buffer, max < CHARDEV_EVENTS ? max : CHARDEV_EVENTS);
+	if (ret <= 0) return ret;
+
+// the kernel stamps with CLOCK_MONOTONIC, the offsets to the other clocks change slow enough
+// to be taken now for the whole batch
+	raw  = clock_ns (CLOCK_MONOTONIC_RAW);
+	mono = clock_ns (CLOCK_MONOTONIC);
+	real = clock_ns (CLOCK_REALTIME);
+
+	for (i = 0 ; i < ret ; i++) {
+		int64_t stamp;
+
+		event = gpiod_edge_event_buffer_get_event (lines->buffer, i);
+		stamp = gpiod_edge_event_get_timestamp_ns (event);
+		offset = gpiod_edge_event_get_line_offset (event);
+		idx[i] = lines->pin[1] >= 0 && offset == (unsigned int) lines->pin[1];
+
+		memset (&edge[i], 0, sizeof (edge[i]));
+		edge[i].mono = stamp + raw - mono;
+		edge[i].real = stamp + real - mono;
+		edge[i].pin = offset <= INT8_MAX ? (int8_t) offset : -1;
+		edge[i].level = gpiod_edge_event_get_event_type (event) == GPIOD_EDGE_EVENT_RISING_EDGE;
+	}
+
+	return ret;
+}
+
+
+
+void chardev_close (chardev_lines *lines) {
+
+	if (lines->request) gpiod_line_request_release (lines->request);
+	if (lines->buffer) gpiod_edge_event_buffer_free (lines->buffer);
+	if (lines->chip) gpiod_chip_close (lines->chip);
+
+	lines->request = NULL;
+	lines->buffer = NULL;
+	lines->chip = NULL;
+}
+
+
+
+// read the edges of a receiver in batches, the only producer of both pins
+static void *gpiod_thread (void *arg) {
+
+	edge_source *src = arg;
+	chardev_lines *lines = src->priv;
+	edge_t edge[CHARDEV_EVENTS];
+	int idx[CHARDEV_EVENTS];
+	int count, i, j;
+
+	if (src->setup) src->setup (src);
+
+	while (1) {
+		count = chardev_read (lines, edge, idx, CHARDEV_EVENTS, 1000);
+		if (count < 0) {
+			if (errno == EINTR) continue;
+			if (src->debug) printf ("can't read GPIO of receiver %d: %s\n", src->index, strerror (errno));
+			break;
+		}
+
+// hand over the runs of edges of the same pin
+		for (i = 0 ; i < count ; i = j) {
+			for (j = i + 1 ; j < count && idx[j] == idx[i] ; j++);
+			src->sink (src->sink_arg, idx[i], &edge[i], j - i);
+		}
+	}
+
+	return NULL;
+}
+
+
+
+static int gpiod_start (edge_source *src) {
+
+	chardev_lines *lines;
+
+	if ((lines = malloc (sizeof (*lines))) == NULL) return -1;
+	if (chardev_open (lines, src->arg ? src->arg : CHARDEV_CHIP, src->pin, src->debounce) < 0) {
+		free (lines);
+		return -1;
+	}
+
+	src->priv = lines;
+	if (pthread_create (&src->thread, NULL, gpiod_thread, src) != 0) {
+		chardev_close (lines);
+		free (lines);
+		return -1;
+	}
+	return 0;
+}
+
+
+
+const source_ops source_gpiod = {
+	"gpiod", "gpiod[:<chip>]", "GPIO character device with kernel timestamps (default " CHARDEV_CHIP "),\n"
+	"                                   '-g' takes the line offsets of the chip", 1, gpiod_start
+};
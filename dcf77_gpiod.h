@@ -0,0 +1,32 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * edges with kernel timestamps from the GPIO character device (libgpiod v2).
+ */
+
+#ifndef DCF77_GPIOD_H
+#define DCF77_GPIOD_H
+
+#include <stddef.h>
+
+#include "dcf77_trace.h"
+
+#define CHARDEV_CHIP   "/dev/gpiochip0"
+#define CHARDEV_EVENTS 64		// events read at once, also the buffer size in the kernel
+
+struct gpiod_chip;
+struct gpiod_line_request;
+struct gpiod_edge_event_buffer;
+
+// the lines of one receiver, requested together
+typedef struct {
+	struct gpiod_chip *chip;
+	struct gpiod_line_request *request;
+	struct gpiod_edge_event_buffer *buffer;
+	int pin[2];		// line offsets, pin[1] < 0 without inverted output
+} chardev_lines;
+
+int chardev_open (chardev_lines *lines, const char *chip, const int *pin, const unsigned long debounce);
+int chardev_read (chardev_lines *lines, edge_t *edge, int *idx, const size_t max, const int timeout);
+void chardev_close (chardev_lines *lines);
+
+#endif
@@ -0,0 +1,100 @@
+#!/bin/sh
+#
+# DCF77 decoder for the RaspberryPi
+# drive the edges of a trace on a simulated GPIO chip (gpio-sim), to test '-S gpiod' without a receiver.
+#
+# Creates a chip in configfs, prints its device and plays the edges of the trace
+# (e.g. of 'dcf77_gen') in real time by setting the pull of the lines.
+# With two lines the second one gets the inverted level, like the inverted output of a receiver.
+# The chip is removed again on exit. Needs root and the module 'gpio-sim'.
+#
+#   dcf77_gen -o /tmp/dcf77.trace -s 1711841400 -e 1711841700
+#   dcf77_gpiosim.sh -n 256 -l 150,151 /tmp/dcf77.trace &
+#   dcf77_clock -D -S gpiod:/dev/gpiochipN -g 150,151
+#
+
+lines=8
+line0=0
+line1=
+wait=5
+
+usage () {
+	echo "Usage: $0 [-h] [-n <lines>] [-l <line>[,<line>]] [-w <sec>] <trace>" >&2
+	echo "    -h          this helptext" >&2
+	echo "    -n <lines>  lines of the simulated chip (default: 8)" >&2
+	echo "    -l <line>   line offset to drive, ',<line>' for a second line with inverted level (default: 0)" >&2
+	echo "    -w <sec>    wait before the first edge, to start dcf77_clock (default: 5)" >&2
+	exit 1
+}
+
+while getopts "hn:l:w:" opt ; do
+	case "$opt" in
+		n) lines="$OPTARG" ;;
+		l) line0="${OPTARG%%,*}" ; [ "$line0" != "$OPTARG" ] && line1="${OPTARG#*,}" ;;
+		w) wait="$OPTARG" ;;
+		*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 1 ] || usage
+trace="$1"
+
+sim=/sys/kernel/config/gpio-sim/dcf77_$$
+
+modprobe gpio-sim 2>/dev/null
+if ! mkdir "$sim" 2>/dev/null ; then
+	echo "Can't create the chip in '$sim', is configfs mounted and gpio-sim loaded? exit." >&2
+	exit 1
+fi
+
+cleanup () {
+	echo 0 > "$sim/live" 2>/dev/null
+	rmdir "$sim/bank0" "$sim" 2>/dev/null
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+mkdir "$sim/bank0"
+echo "$lines" > "$sim/bank0/num_lines"
+echo 1 > "$sim/live" || exit 1
+
+chip=$(cat "$sim/bank0/chip_name")
+dev=/sys/devices/platform/$(cat "$sim/dev_name")/$chip
+echo "/dev/$chip"
+
+# the pull sets the level the consumer reads
+pull () {
+	echo "$2" > "$dev/sim_gpio$1/pull"
+}
+level () {
+	if [ "$1" -ne 0 ] ; then
+		pull "$line0" pull-up
+		[ -n "$line1" ] && pull "$line1" pull-down
+	else
+		pull "$line0" pull-down
+		[ -n "$line1" ] && pull "$line1" pull-up
+	fi
+}
+
+# start with the level before the first edge, the pull up requested by dcf77_clock may still take the first edge
+set -- $(od -An -v -t d8 -w24 -j 64 -N 24 "$trace")
+[ $# -eq 3 ] || { echo "No edge in '$trace'! exit." >&2 ; exit 1 ; }
+level $(( ($3 >> 8) & 255 ^ 1 ))
+sleep "$wait"
+
+# the records after the header of 64 bytes: mono, real and pin with level (second byte), 24 bytes each
+# only the edges of the first pin of the trace are played, the second line follows them
+start=
+first=
+od -An -v -t d8 -w24 -j 64 "$trace" | while read mono real pinlevel ; do
+	pin=$((pinlevel & 255))
+	[ -z "$first" ] && first=$pin
+	[ "$pin" -ne "$first" ] && continue
+	now=$(date +%s%N)
+	if [ -z "$start" ] ; then
+		start=$((now - mono))
+	fi
+	delay=$((start + mono - now))
+	[ "$delay" -gt 0 ] && sleep "$(printf '%d.%09d' $((delay / 1000000000)) $((delay % 1000000000)))"
+	level $(( (pinlevel >> 8) & 255 ))
+done
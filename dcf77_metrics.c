@@ -0,0 +1,106 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * map, write and read the metrics page.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dcf77_metrics.h"
+
+
+
+// map the metrics page, the daemon ('write' set) starts it empty, a reader only takes a page of the same format
+// return the page or NULL on error
+dcf77_metrics *metrics_map (const char *name, const int write) {
+
+	dcf77_metrics *metrics;
+	struct stat st;
+	int fd;
+
+	if ((fd = open (name, write ? O_RDWR | O_CREAT : O_RDONLY, 0644)) < 0) return NULL;
+	if (fstat (fd, &st) < 0 || (st.st_size != sizeof (*metrics) && (!write || ftruncate (fd, sizeof (*metrics)) < 0))) {
+		close (fd);
+		return NULL;
+	}
+
+	metrics = mmap (NULL, sizeof (*metrics), write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if (metrics == MAP_FAILED) return NULL;
+
+	if (write) {
+		memset (metrics, 0, sizeof (*metrics));
+		memcpy (metrics->magic, DCF77_METRICS_MAGIC, sizeof (metrics->magic));
+		metrics->version = DCF77_METRICS_VERSION;
+		metrics->size = sizeof (*metrics);
+		metrics->pid = getpid ();
+	}
+	else if (memcmp (metrics->magic, DCF77_METRICS_MAGIC, sizeof (metrics->magic)) || metrics->version != DCF77_METRICS_VERSION || metrics->size != sizeof (*metrics)) {
+		munmap (metrics, sizeof (*metrics));
+		return NULL;
+	}
+
+	return metrics;
+}
+
+
+
+// copy the counters of a decoder to its slot, only the thread that feeds the decoder may call it
+void metrics_update (dcf77_metric *slot, const dcf77_decoder *dec) {
+
+	struct timespec now;
+	const uint32_t seq = slot->seq;
+
+	clock_gettime (CLOCK_REALTIME, &now);
+
+	__atomic_store_n (&slot->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+
+	slot->active = 1;
+	slot->updated = now.tv_sec * 1000000000LL + now.tv_nsec;
+	slot->edges = dec->stats.edges;
+	slot->noise = dec->stats.noise;
+	slot->marks = dec->stats.stat[STATS_SECOND].count;
+	slot->minutes = dec->stats.minutes;
+	memcpy (slot->parity, dec->stats.parity, sizeof (slot->parity));
+	slot->resyncs = dec->stats.resyncs;
+	slot->bit_cnt = dec->stats.bit_cnt;
+	slot->bit_err = dec->stats.bit_err;
+	slot->stamp = dec->time_last.stamp;
+	slot->stamp_chk = dec->time_last.stamp_chk;
+	slot->precision = -(dec->precision >> 4);
+	slot->min_dev = dec->min_dev;
+	slot->sig_avr = dec->sig_avr;
+
+	__atomic_store_n (&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+
+// consistent copy of a slot, tries again while the writer is busy
+// return 0 or -1 if the slot stayed busy, the copy is stale then
+int metrics_read (const dcf77_metric *slot, dcf77_metric *copy) {
+
+	struct timespec ts = { 0, 100000L };
+	uint32_t seq;
+	int i;
+
+	for (i = 0 ; i < METRICS_RETRY ; i++) {
+		seq = __atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE);
+		if ((seq & 1) == 0) {
+			memcpy (copy, slot, sizeof (*copy));
+			__atomic_thread_fence (__ATOMIC_ACQUIRE);
+			if (__atomic_load_n (&slot->seq, __ATOMIC_RELAXED) == seq) return 0;
+		}
+		nanosleep (&ts, NULL);
+	}
+	return -1;
+}
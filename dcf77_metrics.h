@@ -0,0 +1,56 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * metrics page, counters and gauges of the receivers in shared memory.
+ *
+ * Every receiver thread writes its own slot with a seqlock: 'seq' is odd
+ * while the slot is written, a reader copies the slot and tries again if
+ * 'seq' was odd or has changed. The writer never waits for a reader,
+ * a reader gives up on a slot that stays busy (a writer killed while writing).
+ * The page is a file, e.g. on /dev/shm, read by 'dcf77_export'.
+ * All values are in host byte order.
+ */
+
+#ifndef DCF77_METRICS_H
+#define DCF77_METRICS_H
+
+#include <stdint.h>
+
+#include "dcf77_decoder.h"
+
+#define DCF77_METRICS_MAGIC   "DCF77MET"
+#define DCF77_METRICS_VERSION 1
+#define METRICS_SLOTS         RECEIVER_MAX	// one per receiver
+#define METRICS_RETRY         100	// a reader gives up on a slot after 100 tries of 100 usec
+
+typedef struct {
+	uint32_t seq;			// seqlock, odd while written
+	uint32_t active;		// the slot belongs to a running receiver
+	int64_t  updated;		// CLOCK_REALTIME of the last update in ns
+	uint64_t edges;
+	uint64_t noise;
+	uint64_t marks;			// second marks
+	uint64_t minutes;		// minute marks
+	uint64_t parity[STATS_FIELDS];
+	uint64_t resyncs;
+	uint64_t bit_cnt;
+	uint64_t bit_err;
+	int64_t  stamp;			// the last minute decoded, 0 if not synced
+	int32_t  stamp_chk;
+	int32_t  precision;		// as power of two, like in the SHM of ntpd
+	int64_t  min_dev;		// nsec
+	int64_t  sig_avr;		// nsec
+} dcf77_metric;
+
+typedef struct {
+	char     magic[8];		// DCF77_METRICS_MAGIC without '\0'
+	uint32_t version;		// DCF77_METRICS_VERSION
+	uint32_t size;			// sizeof (dcf77_metrics)
+	int64_t  pid;			// of the writing daemon
+	dcf77_metric rcv[METRICS_SLOTS];
+} dcf77_metrics;
+
+dcf77_metrics *metrics_map (const char *name, const int write);
+void metrics_update (dcf77_metric *slot, const dcf77_decoder *dec);
+int metrics_read (const dcf77_metric *slot, dcf77_metric *copy);
+
+#endif
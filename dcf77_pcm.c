@@ -0,0 +1,657 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * edges from sampled audio or RF, from a WAV file, raw samples or a pipe.
+ *
+ * The input is 16 bit PCM, a WAV header is optional (raw input is mono),
+ * so 'arecord -f S16_LE -r 48000 | dcf77_clock -S pcm:-' works as well.
+ * The timestamps are counted from the samples, starting at the time the
+ * source is started.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "dcf77_pcm.h"
+#include "dcf77_source.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define PCM_EDGES  (PCM_BLOCK / PCM_LANES)	// at most one edge per envelope value
+#define PCM_ANCHOR 16		// reads of live input the time of the samples is taken from
+
+typedef struct {
+	pcm_input in;
+	pcm_demod dem;
+	pcm_pm pm;
+	int64_t samples;		// read so far
+	int64_t offset[PCM_ANCHOR];	// CLOCK_MONOTONIC_RAW of a read minus the time of its samples
+	int anchor_cnt;
+} pcm_priv;
+
+
+
+static int64_t clock_ns (const clockid_t clock) {
+
+	struct timespec ts;
+
+	clock_gettime (clock, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+
+void pcm_init (pcm_demod *dem, const int rate, const double freq) {
+
+	const double w = 2.0 * M_PI * freq / rate;
+#if PCM_LANES > 1
+	int j;
+#endif
+
+	memset (dem, 0, sizeof (*dem));
+	dem->rate = rate;
+	dem->decim = (rate / PCM_ENV_RATE + PCM_LANES / 2) / PCM_LANES * PCM_LANES;
+	if (dem->decim < PCM_LANES) dem->decim = PCM_LANES;
+
+// the sum is centered half a value back, the smoothing adds (1 - a) / a values
+	dem->delay = (int64_t) ((dem->decim / 2.0 + dem->decim * (1.0 - PCM_SMOOTH) / PCM_SMOOTH) * 1e9 / rate);
+
+#if PCM_LANES > 1
+	for (j = 0 ; j < PCM_LANES ; j++) {
+		dem->osc_c[j] = cos (w * j);
+		dem->osc_s[j] = sin (w * j);
+		dem->rot_c[j] = cos (w * PCM_LANES);
+		dem->rot_s[j] = sin (w * PCM_LANES);
+	}
+#else
+	dem->osc_c = 1.0f;
+	dem->osc_s = 0.0f;
+	dem->rot_c = cos (w);
+	dem->rot_s = sin (w);
+#endif
+}
+
+
+
+// the 512 chips of the sequence, from a shift register with the feedback x^9 + x^5 + 1
+// started with all ones, the 512th chip starts the period again
+void pcm_chips (int8_t *chip) {
+
+	unsigned reg = 0x1ff;
+	int n;
+
+	for (n = 0 ; n < PCM_PM_CHIPS ; n++) {
+		chip[n] = (reg >> 8) & 1;
+		reg = ((reg << 1) | (((reg >> 8) ^ (reg >> 4)) & 1)) & 0x1ff;
+	}
+}
+
+
+
+// the baseband of the correlation at 'rate' / 'decim', the sequence as +-1 at this rate
+void pcm_pm_init (pcm_pm *pm, const int rate, const int debug) {
+
+	int8_t chip[PCM_PM_CHIPS];
+	int n;
+
+	memset (pm, 0, sizeof (*pm));
+	pm->decim = (rate / PCM_PM_RATE + PCM_LANES / 2) / PCM_LANES * PCM_LANES;
+	if (pm->decim < PCM_LANES) pm->decim = PCM_LANES;
+	while (rate / pm->decim > PCM_PM_MAXRATE) pm->decim += PCM_LANES;
+	pm->rate = (double) rate / pm->decim;
+	pm->debug = debug;
+
+	pm->chips = (int) (PCM_PM_CHIPS * PCM_PM_CHIP * pm->rate);
+	pm->len = (pm->chips + PCM_LANES - 1) / PCM_LANES * PCM_LANES;
+	pm->search = (int) (PCM_PM_SEARCH * pm->rate);
+	pm->ref_len = (int) (PCM_PM_REF * pm->rate);
+	if (pm->ref_len < 8) pm->ref_len = 8;
+
+	pcm_chips (chip);
+	for (n = 0 ; n < pm->chips ; n++) pm->tmpl[n] = chip[(int) (n / pm->rate / PCM_PM_CHIP)] ? -1.0f : 1.0f;
+}
+
+
+
+// one baseband value, its phase against the mean of the last PCM_PM_REF is kept
+// for the value in the middle of the window, so the reference adds no delay
+static void pm_value (pcm_pm *pm, const float i, const float q) {
+
+	const int slot = pm->count % pm->ref_len;
+	double mag;
+	int mid;
+
+	pm->ref_sum_i += i - pm->ref_i[slot];
+	pm->ref_sum_q += q - pm->ref_q[slot];
+	pm->ref_i[slot] = i;
+	pm->ref_q[slot] = q;
+	pm->count++;
+	if (pm->count < pm->ref_len) return;
+
+	mid = (pm->count - 1 - pm->ref_len / 2) % pm->ref_len;
+	mag = sqrt (pm->ref_sum_i * pm->ref_sum_i + pm->ref_sum_q * pm->ref_sum_q) + 1e-9;
+	pm->y[(pm->count - 1 - pm->ref_len / 2) & (PCM_PM_HIST - 1)] = (pm->ref_q[mid] * pm->ref_sum_i - pm->ref_i[mid] * pm->ref_sum_q) / mag;
+}
+
+
+
+static float pm_dot (const float *a, const float *b, const int len) {
+
+	float sum = 0.0f;
+	int n;
+
+#if PCM_LANES > 1
+	static const pcm_vec zero;
+	pcm_vec acc = zero, va, vb;
+	int j;
+
+	for (n = 0 ; n < len ; n += PCM_LANES) {
+		memcpy (&va, a + n, sizeof (va));
+		memcpy (&vb, b + n, sizeof (vb));
+		acc += va * vb;
+	}
+	for (j = 0 ; j < PCM_LANES ; j++) sum += acc[j];
+#else
+	for (n = 0 ; n < len ; n++) sum += a[n] * b[n];
+#endif
+
+	return sum;
+}
+
+
+
+// correlate the sequence around 200 msec after the start of a pulse
+// return 0 while the baseband is not complete yet
+static int pm_correlate (pcm_demod *dem, pcm_edge *edge, const pcm_edge *next) {
+
+	pcm_pm *pm = dem->pm;
+	const int64_t avail = pm->count - pm->ref_len / 2;
+	const double start = ((edge->time * 1e-9 + PCM_PM_START) * pm->rate * pm->decim + 0.5) / pm->decim - 0.5;
+	const int64_t first = (int64_t) floor (start + 0.5) - pm->search;
+	const int lags = 2 * pm->search + 1;
+	float best = 0.0f, a, b, c, corr, frac;
+	int64_t time, n;
+	int peak = -1, l;
+
+	if (avail < first + lags + pm->len) return 0;
+	edge->done = 1;
+
+	if (first < pm->ref_len || first < avail - PCM_PM_HIST) {
+		pm->missed++;
+		return 1;
+	}
+
+	for (n = 0 ; n < lags + pm->len - 1 ; n++) pm->seg[n] = pm->y[(first + n) & (PCM_PM_HIST - 1)];
+	for (l = 0 ; l < lags ; l++) {
+		pm->corr[l] = pm_dot (pm->tmpl, pm->seg + l, pm->len);
+		if (fabsf (pm->corr[l]) > best) {
+			best = fabsf (pm->corr[l]);
+			peak = l;
+		}
+	}
+
+	corr = best / sqrtf (pm->chips * pm_dot (pm->seg + peak, pm->seg + peak, pm->len) + 1e-20f);
+	if (peak <= 0 || peak >= lags - 1 || corr < PCM_PM_MIN) {
+		if (pm->debug) printf ("PM: no sequence found (Corr: %.2f)\n", corr);
+		pm->missed++;
+		return 1;
+	}
+
+// the peak of the correlation of chips is a triangle, the interpolation fits one
+	a = fabsf (pm->corr[peak - 1]);
+	b = best;
+	c = fabsf (pm->corr[peak + 1]);
+	frac = 0.5f * (c - a) / (b - (a < c ? a : c) + 1e-20f);
+
+// a baseband value is the middle of its samples
+	time = (int64_t) ((((first + peak + frac + 0.5) * pm->decim - 0.5) / (pm->rate * pm->decim) - PCM_PM_START) * 1e9);
+	if (pm->debug) printf ("PM: %+10.3lf usec to the AM edge / Corr: %.2f / Bit: %d\n", 0.001 * (time - edge->time), corr, pm->corr[peak] < 0.0f);
+	if (time < 0 || (next && time >= next->time)) {
+		pm->missed++;
+		return 1;
+	}
+
+	edge->time = time;
+	edge->pm = corr;
+	pm->found++;
+	return 1;
+}
+
+
+
+// hand over the edges held back, the start of a pulse when it is correlated
+static void pcm_release (pcm_demod *dem, pcm_edge *edge, size_t *count, const size_t max, const int force) {
+
+	while (dem->hold_cnt > 0 && *count < max) {
+		if (dem->hold[0].level == 1 && dem->hold[0].done == 0 && force == 0) {
+			if (pm_correlate (dem, &dem->hold[0], dem->hold_cnt > 1 ? &dem->hold[1] : NULL) == 0) return;
+		}
+		edge[(*count)++] = dem->hold[0];
+		memmove (&dem->hold[0], &dem->hold[1], --dem->hold_cnt * sizeof (pcm_edge));
+	}
+}
+
+
+
+static void pcm_emit (pcm_demod *dem, const int64_t time, pcm_edge *edge, size_t *count, const size_t max) {
+
+	pcm_edge *e;
+
+	if (dem->pm) {
+		if (dem->hold_cnt == PCM_HOLD) pcm_release (dem, edge, count, max, 1);
+		if (dem->hold_cnt == PCM_HOLD) return;
+		e = &dem->hold[dem->hold_cnt++];
+	}
+	else if (*count < max) e = &edge[(*count)++];
+	else return;
+
+	memset (e, 0, sizeof (*e));
+	e->time = time < 0 ? 0 : time;
+	e->level = dem->level;
+}
+
+
+
+// one value of the envelope from the I/Q sums, a crossing of the threshold is an edge
+static void pcm_value (pcm_demod *dem, const float i, const float q, pcm_edge *edge, size_t *count, const size_t max) {
+
+	const float mag = sqrtf (i * i + q * q) * 2.0f / dem->decim;
+	float thr, frac;
+
+	dem->env_last = dem->env;
+	dem->env += (mag - dem->env) * PCM_SMOOTH;
+
+// the carrier level goes up fast and down slowly, it is held during a drop
+	if (dem->env > dem->carrier) dem->carrier += (dem->env - dem->carrier) * PCM_SMOOTH;
+	else if (dem->level == 0) dem->carrier += (dem->env - dem->carrier) * PCM_TRACK;
+
+	thr = (dem->level ? PCM_RISE : PCM_DROP) * dem->carrier;
+	if (dem->level ? dem->env <= thr : dem->env >= thr) return;
+	dem->level = !dem->level;
+
+// the crossing is interpolated between the last two values
+	frac = (dem->env_last - thr) / (dem->env_last - dem->env);
+	if (frac < 0.0f || frac > 1.0f) frac = 1.0f;
+	pcm_emit (dem, (int64_t) ((dem->sample - (1.0f - frac) * dem->decim) * 1e9 / dem->rate) - dem->delay, edge, count, max);
+}
+
+
+
+// 'count' must be a multiple of PCM_LANES, return the number of edges found
+size_t pcm_demodulate (pcm_demod *dem, const int16_t *pcm, const size_t count, pcm_edge *edge, const size_t max) {
+
+	size_t n, found = 0;
+	float i, q, norm;
+
+#if PCM_LANES > 1
+	static const pcm_vec zero;
+	pcm_vec x = zero, c, mix_i, mix_q;
+	pcm_pm *pm = dem->pm;
+	int j;
+
+	for (n = 0 ; n + PCM_LANES <= count ; n += PCM_LANES) {
+		for (j = 0 ; j < PCM_LANES ; j++) x[j] = pcm[n + j];
+
+		mix_i = x * dem->osc_c;
+		mix_q = x * dem->osc_s;
+		dem->sum_i += mix_i;
+		dem->sum_q -= mix_q;
+		c = dem->osc_c * dem->rot_c - dem->osc_s * dem->rot_s;
+		dem->osc_s = dem->osc_s * dem->rot_c + dem->osc_c * dem->rot_s;
+		dem->osc_c = c;
+
+		if (pm) {
+			pm->sum_i += mix_i;
+			pm->sum_q -= mix_q;
+			pm->fill += PCM_LANES;
+			if (pm->fill >= pm->decim) {
+				for (i = q = 0.0f, j = 0 ; j < PCM_LANES ; j++) {
+					i += pm->sum_i[j];
+					q += pm->sum_q[j];
+				}
+				pm->sum_i = zero;
+				pm->sum_q = zero;
+				pm->fill = 0;
+				pm_value (pm, i, q);
+				pcm_release (dem, edge, &found, max, 0);
+			}
+		}
+
+		dem->sample += PCM_LANES;
+		dem->fill += PCM_LANES;
+		if (dem->fill < dem->decim) continue;
+		dem->fill = 0;
+
+		for (i = q = 0.0f, j = 0 ; j < PCM_LANES ; j++) {
+			i += dem->sum_i[j];
+			q += dem->sum_q[j];
+		}
+		dem->sum_i = zero;
+		dem->sum_q = zero;
+
+// keep the oscillator on the unit circle
+		norm = 1.5f - 0.5f * (dem->osc_c[0] * dem->osc_c[0] + dem->osc_s[0] * dem->osc_s[0]);
+		dem->osc_c *= norm;
+		dem->osc_s *= norm;
+
+		pcm_value (dem, i, q, edge, &found, max);
+	}
+#else
+	float c, mix_i, mix_q;
+	pcm_pm *pm = dem->pm;
+
+	for (n = 0 ; n < count ; n++) {
+		mix_i = pcm[n] * dem->osc_c;
+		mix_q = pcm[n] * dem->osc_s;
+		dem->acc_i += mix_i;
+		dem->acc_q -= mix_q;
+		c = dem->osc_c * dem->rot_c - dem->osc_s * dem->rot_s;
+		dem->osc_s = dem->osc_s * dem->rot_c + dem->osc_c * dem->rot_s;
+		dem->osc_c = c;
+
+		if (pm) {
+			pm->acc_i += mix_i;
+			pm->acc_q -= mix_q;
+			if (++pm->fill >= pm->decim) {
+				pm_value (pm, pm->acc_i, pm->acc_q);
+				pm->acc_i = pm->acc_q = 0.0f;
+				pm->fill = 0;
+				pcm_release (dem, edge, &found, max, 0);
+			}
+		}
+
+		dem->sample++;
+		if (++dem->fill < dem->decim) continue;
+		dem->fill = 0;
+
+		i = dem->acc_i;
+		q = dem->acc_q;
+		dem->acc_i = dem->acc_q = 0.0f;
+
+		norm = 1.5f - 0.5f * (dem->osc_c * dem->osc_c + dem->osc_s * dem->osc_s);
+		dem->osc_c *= norm;
+		dem->osc_s *= norm;
+
+		pcm_value (dem, i, q, edge, &found, max);
+	}
+#endif
+
+	return found;
+}
+
+
+
+// the edges held back at the end of the input, without correlation
+size_t pcm_flush (pcm_demod *dem, pcm_edge *edge, const size_t max) {
+
+	size_t found = 0;
+
+	pcm_release (dem, edge, &found, max, 1);
+	return found;
+}
+
+
+
+static uint32_t le32 (const uint8_t *p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint16_t le16 (const uint8_t *p) {
+	return p[0] | p[1] << 8;
+}
+
+// read exactly 'len' bytes, return 0 or -1 at the end
+static int pcm_fill (const int fd, uint8_t *buf, const size_t len) {
+
+	size_t done;
+	ssize_t ret;
+
+	for (done = 0 ; done < len ; done += ret) {
+		ret = read (fd, buf + done, len - done);
+		if (ret < 0 && errno == EINTR) ret = 0;
+		else if (ret <= 0) return -1;
+	}
+	return 0;
+}
+
+
+
+// open a WAV file or raw samples ('-' for stdin), 'rate' is the rate of raw samples
+// the input is left at the first sample, only the samples of the data chunk are read from a WAV
+// (a size of 0xffffffff, as written to a pipe, reads up to the end)
+// return 0 or -1 on error
+int pcm_open (pcm_input *in, const char *name, const int rate) {
+
+	uint8_t head[16], skip[256];
+	struct stat st;
+	uint32_t size;
+
+	memset (in, 0, sizeof (*in));
+	in->rate = rate;
+	in->channels = 1;
+	in->left = -1;
+
+	if (strcmp (name, "-") == 0) in->fd = STDIN_FILENO;
+	else if ((in->fd = open (name, O_RDONLY)) < 0) return -1;
+
+	if (fstat (in->fd, &st) < 0) goto fail;
+	in->live = !S_ISREG (st.st_mode);
+
+	if (pcm_fill (in->fd, head, 12) < 0) goto fail;
+
+// raw samples, the bytes read are the first samples
+	if (memcmp (head, "RIFF", 4) || memcmp (head + 8, "WAVE", 4)) {
+		memcpy (in->pending, head, 12);
+		in->pending_len = 12;
+		return 0;
+	}
+
+// the chunks up to the samples, a pipe can't seek
+	while (1) {
+		if (pcm_fill (in->fd, head, 8) < 0) goto fail;
+		size = le32 (head + 4);
+
+		if (memcmp (head, "data", 4) == 0) {
+			if (in->rate <= 0) goto fail;
+			if (size != 0xffffffffU) in->left = size;
+			return 0;
+		}
+
+		if (memcmp (head, "fmt ", 4) == 0) {
+			if (size < 16 || pcm_fill (in->fd, head, 16) < 0) goto fail;
+			if ((le16 (head) != 1 && le16 (head) != 0xfffe) || le16 (head + 14) != 16) goto fail;
+			in->channels = le16 (head + 2);
+			in->rate = le32 (head + 4);
+			if (in->channels < 1 || in->channels > PCM_CHANNELS) goto fail;
+			size -= 16;
+		}
+
+		for (size += size & 1 ; size > 0 ; size -= size > sizeof (skip) ? sizeof (skip) : size) {
+			if (pcm_fill (in->fd, skip, size > sizeof (skip) ? sizeof (skip) : size) < 0) goto fail;
+		}
+	}
+
+fail:
+	pcm_close (in);
+	return -1;
+}
+
+
+
+// close the input, stdin is left open
+void pcm_close (pcm_input *in) {
+	if (in->fd != STDIN_FILENO && in->fd >= 0) close (in->fd);
+	in->fd = -1;
+}
+
+
+
+// read up to 'max' samples of the first channel, return the number or 0 at the end
+size_t pcm_read (pcm_input *in, int16_t *pcm, const size_t max) {
+
+	uint8_t buf[PCM_BLOCK * 2 * PCM_CHANNELS];
+	const size_t frame = 2 * in->channels;
+	size_t fill = in->pending_len, want = (max < PCM_BLOCK ? max : PCM_BLOCK) * frame, count, len, i;
+	ssize_t ret;
+
+	memcpy (buf, in->pending, fill);
+	while (fill < frame || fill < want / 2) {
+		len = want - fill;
+		if (in->left >= 0 && (int64_t) len > in->left) len = in->left;
+		if (len == 0) break;
+		ret = read (in->fd, buf + fill, len);
+		if (ret < 0 && errno == EINTR) continue;
+		if (ret <= 0) break;
+		fill += ret;
+		if (in->left >= 0) in->left -= ret;
+	}
+
+	count = fill / frame;
+	if (count > max) count = max;
+	for (i = 0 ; i < count ; i++) pcm[i] = (int16_t) le16 (buf + i * frame);
+
+	in->pending_len = fill - count * frame;
+	memcpy (in->pending, buf + count * frame, in->pending_len);
+	return count;
+}
+
+
+
+// the edges to the receiver, wait while the queue is full, a file is read faster then real time
+static void pcm_push (edge_source *src, const int64_t base_mono, const int64_t base_real, const pcm_edge *found, const size_t count) {
+
+	struct timespec ts = { 0, 1000000L };
+	edge_t edge[PCM_EDGES];
+	size_t i, done;
+
+	for (i = 0 ; i < count ; i++) {
+		memset (&edge[i], 0, sizeof (edge[i]));
+		edge[i].mono = base_mono + found[i].time;
+		edge[i].real = base_real + found[i].time;
+		edge[i].level = found[i].level;
+	}
+
+	for (done = 0 ; done < count ; ) {
+		done += src->sink (src->sink_arg, 0, &edge[done], count - done);
+		if (done < count) nanosleep (&ts, NULL);
+	}
+}
+
+
+
+// the clock of a sound card drifts against the system clock and the reads come late by the buffers,
+// so the time of live samples is taken again at every read: a read returns at the earliest
+// when its last sample has arrived, the smallest offset of the last reads has the least delay
+static void pcm_anchor (pcm_priv *priv, int64_t *base_mono, int64_t *base_real) {
+
+	const int64_t mono = clock_ns (CLOCK_MONOTONIC_RAW), real = clock_ns (CLOCK_REALTIME);
+	const int rate = priv->in.rate;
+	int64_t best;
+	int i, n;
+
+	priv->offset[priv->anchor_cnt++ % PCM_ANCHOR] = mono - (priv->samples / rate * 1000000000LL + priv->samples % rate * 1000000000LL / rate);
+	n = priv->anchor_cnt < PCM_ANCHOR ? priv->anchor_cnt : PCM_ANCHOR;
+	for (best = priv->offset[0], i = 1 ; i < n ; i++) if (priv->offset[i] < best) best = priv->offset[i];
+
+	*base_mono = best;
+	*base_real = best + real - mono;
+}
+
+
+
+// a file is counted from the start of the source, live input follows the reads
+static void *pcm_thread (void *arg) {
+
+	edge_source *src = arg;
+	pcm_priv *priv = src->priv;
+	int16_t pcm[PCM_BLOCK];
+	pcm_edge found[PCM_EDGES];
+	int64_t base_mono = clock_ns (CLOCK_MONOTONIC_RAW), base_real = clock_ns (CLOCK_REALTIME);
+	size_t fill = 0, count, use;
+
+	if (src->setup) src->setup (src);
+	while ((count = pcm_read (&priv->in, pcm + fill, PCM_BLOCK - fill)) > 0) {
+		priv->samples += count;
+		if (priv->in.live) pcm_anchor (priv, &base_mono, &base_real);
+		fill += count;
+		use = fill - fill % PCM_LANES;
+		count = pcm_demodulate (&priv->dem, pcm, use, found, PCM_EDGES);
+		memmove (pcm, pcm + use, (fill - use) * sizeof (int16_t));
+		fill -= use;
+		pcm_push (src, base_mono, base_real, found, count);
+	}
+	pcm_push (src, base_mono, base_real, found, pcm_flush (&priv->dem, found, PCM_EDGES));
+
+	if (src->debug) {
+		printf ("receiver %d: end of samples '%s'\n", src->index, src->arg);
+		if (priv->dem.pm) printf ("receiver %d: %lu seconds by the phase modulation, %lu by the AM edge\n", src->index, priv->pm.found, priv->pm.missed);
+	}
+	pcm_close (&priv->in);
+	if (src->done) src->done (src);
+	return NULL;
+}
+
+
+
+// 'arg' is '<file>[,<rate>[,<freq>[,pm]]]'
+static int pcm_start (edge_source *src) {
+
+	char name[256], *next;
+	pcm_priv *priv;
+	int rate = PCM_RATE, pm = 0;
+	double freq = PCM_FREQ;
+
+	if (src->arg == NULL || (priv = calloc (1, sizeof (*priv))) == NULL) return -1;
+
+	strncpy (name, src->arg, sizeof (name) - 1);
+	name[sizeof (name) - 1] = '\0';
+	if ((next = strchr (name, ',')) != NULL) {
+		*next++ = '\0';
+		rate = strtol (next, &next, 10);
+		if (*next == ',') freq = strtod (next + 1, &next);
+		if (*next == ',') pm = strcmp (next + 1, "pm") == 0;
+	}
+
+	if (pcm_open (&priv->in, name, rate) < 0) {
+		free (priv);
+		return -1;
+	}
+	if (priv->in.rate <= 0 || freq <= 0 || freq >= priv->in.rate / 2) {
+		pcm_close (&priv->in);
+		free (priv);
+		return -1;
+	}
+	pcm_init (&priv->dem, priv->in.rate, freq);
+	if (src->debug) printf ("receiver %d: %d Hz, %d channels, carrier at %.0lf Hz, %d samples per envelope value (%d lanes), %s\n",
+		src->index, priv->in.rate, priv->in.channels, freq, priv->dem.decim, PCM_LANES, priv->in.live ? "timed by the reads" : "timed by the samples");
+
+	if (pm) {
+		pcm_pm_init (&priv->pm, priv->in.rate, src->debug);
+		priv->dem.pm = &priv->pm;
+		if (src->debug) printf ("receiver %d: phase modulation at %.0lf Hz, %d values per sequence\n", src->index, priv->pm.rate, priv->pm.chips);
+	}
+
+	if (priv->in.live == 0) src->precision = PCM_PREC_FILE;
+	src->priv = priv;
+	src->wait = 1;
+	return pthread_create (&src->thread, NULL, pcm_thread, src) ? -1 : 0;
+}
+
+
+
+const source_ops source_pcm = {
+	"pcm", "pcm:<file>", "16 bit samples, WAV or raw (',<rate>[,<hz>[,pm]]' after the file)", 0, pcm_start
+};
@@ -0,0 +1,141 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * edges from sampled audio or RF, e.g. a sound card or SDR on a down-converted antenna.
+ *
+ * The carrier (77.5 kHz moved to 'freq') is mixed to zero with an I/Q
+ * oscillator, summed over ~1 msec and the magnitude is smoothed. A drop of
+ * the amplitude below half of the carrier level starts a pulse (level 1),
+ * like the output of a receiver module.
+ * The mixer runs on GCC vector extensions (SSE, AVX, NEON), with a scalar
+ * version for other targets.
+ *
+ * Optionally the phase modulation is used as well: from 200 msec after the
+ * start of the second the carrier is shifted by a pseudo-random sequence
+ * of 512 chips (of 120 carrier periods each). The phase of the baseband is
+ * correlated with the sequence around the expected start, the peak gives
+ * the start of the second far sharper than the AM edge. The edges are held
+ * back until the correlation is done (about a second), the start of a
+ * pulse is then moved to the start of the second found.
+ */
+
+#ifndef DCF77_PCM_H
+#define DCF77_PCM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "dcf77_trace.h"
+
+#define PCM_RATE     48000	// default sample rate of raw input (Hz)
+#define PCM_FREQ     1000	// default frequency of the carrier in the input (Hz)
+#define PCM_ENV_RATE 1000	// about the rate of the envelope (Hz)
+#define PCM_SMOOTH   0.3f	// weight of a new envelope value
+#define PCM_TRACK    0.002f	// the carrier level follows within ~0.5 sec
+#define PCM_DROP     0.5f	// start of a pulse, of the carrier level
+#define PCM_RISE     0.7f	// end of a pulse, of the carrier level
+#define PCM_BLOCK    4096	// samples read at once
+#define PCM_CHANNELS 8		// most channels of a WAV file
+
+#define PCM_PM_RATE    8000		// about the rate of the baseband for the correlation (Hz)
+#define PCM_PM_MAXRATE 16000
+#define PCM_PM_CHIPS   512
+#define PCM_PM_CHIP    (120.0 / 77500.0)	// length of a chip (sec)
+#define PCM_PM_START   0.2		// start of the sequence in the second (sec)
+#define PCM_PM_SEARCH  0.015	// around the AM edge (sec)
+#define PCM_PM_REF     0.05		// window of the phase reference (sec)
+#define PCM_PM_MIN     0.1f		// least normalized correlation
+#define PCM_PM_HIST    32768	// baseband values kept, a power of two
+#define PCM_PM_LEN     12720	// longest sequence in baseband values, at PCM_PM_MAXRATE
+#define PCM_PM_LAGS    481		// 2 * PCM_PM_SEARCH * PCM_PM_MAXRATE + 1
+#define PCM_PM_REFLEN  800		// PCM_PM_REF * PCM_PM_MAXRATE
+#define PCM_HOLD       64		// edges held back for the correlation
+#define PCM_PREC_FILE  -10		// precision of a file (2^-10 sec): its sample clock is not tied to the system clock,
+								// the correlation does not make it better then the AM edge
+
+#if defined (__GNUC__) && defined (__AVX__)
+#define PCM_LANES 8
+#elif defined (__GNUC__) && (defined (__SSE__) || defined (__ARM_NEON) || defined (__ALTIVEC__))
+#define PCM_LANES 4
+#else
+#define PCM_LANES 1		// scalar
+#endif
+
+#if PCM_LANES > 1
+typedef float pcm_vec __attribute__ ((vector_size (PCM_LANES * sizeof (float))));
+#endif
+
+// one edge of the envelope, 'time' in nsec after the first sample
+typedef struct {
+	int64_t time;
+	int level;
+	int done;			// the start of a pulse is correlated
+	float pm;			// normalized correlation of the sequence, 0 if the AM edge is used
+} pcm_edge;
+
+typedef struct {
+	double rate;		// of the baseband
+	int decim;			// samples per baseband value, a multiple of PCM_LANES
+	int fill;
+	float acc_i, acc_q;
+#if PCM_LANES > 1
+	pcm_vec sum_i, sum_q;
+#endif
+	int len;			// of the sequence in baseband values
+	int chips;			// baseband values of the sequence that are not padding
+	int search;			// lags before and after the expected start
+	int ref_len;
+	float ref_i[PCM_PM_REFLEN], ref_q[PCM_PM_REFLEN];
+	double ref_sum_i, ref_sum_q;
+	int64_t count;		// baseband values
+	float y[PCM_PM_HIST];	// phase of the baseband against the reference
+	float tmpl[PCM_PM_LEN + PCM_LANES];
+	float seg[PCM_PM_LEN + PCM_PM_LAGS + PCM_LANES];
+	float corr[PCM_PM_LAGS];
+	int debug;
+	unsigned long found, missed;
+} pcm_pm;
+
+typedef struct {
+	int rate;
+	int decim;			// samples per envelope value, a multiple of PCM_LANES
+	int fill;			// samples summed for the next value
+	float acc_i, acc_q;
+#if PCM_LANES > 1
+	pcm_vec osc_c, osc_s;	// oscillator of the next PCM_LANES samples
+	pcm_vec rot_c, rot_s;	// rotation by PCM_LANES samples
+	pcm_vec sum_i, sum_q;
+#else
+	float osc_c, osc_s;
+	float rot_c, rot_s;
+#endif
+	float env;			// smoothed magnitude
+	float env_last;
+	float carrier;		// level of the carrier without drop
+	int level;			// 1 during a drop
+	int64_t sample;		// samples consumed
+	int64_t delay;		// of the filter in nsec
+	pcm_pm *pm;			// NULL without the phase modulation
+	pcm_edge hold[PCM_HOLD];
+	int hold_cnt;
+} pcm_demod;
+
+typedef struct {
+	int fd;
+	int rate;
+	int channels;		// of the input, only the first is used
+	uint8_t pending[16];	// bytes of a frame not complete yet
+	size_t pending_len;
+	int64_t left;		// bytes of the data chunk not read yet, -1 for raw samples up to the end
+	int live;			// a pipe or device: the samples come in real time, not a file
+} pcm_input;
+
+void pcm_init (pcm_demod *dem, const int rate, const double freq);
+void pcm_pm_init (pcm_pm *pm, const int rate, const int debug);
+void pcm_chips (int8_t *chip);
+size_t pcm_demodulate (pcm_demod *dem, const int16_t *pcm, const size_t count, pcm_edge *edge, const size_t max);
+size_t pcm_flush (pcm_demod *dem, pcm_edge *edge, const size_t max);
+int pcm_open (pcm_input *in, const char *name, const int rate);
+size_t pcm_read (pcm_input *in, int16_t *pcm, const size_t max);
+void pcm_close (pcm_input *in);
+
+#endif
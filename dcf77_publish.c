@@ -0,0 +1,119 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * the socket for the third-party data and the thread that takes the clients.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "dcf77_publish.h"
+
+
+
+// the whole line or nothing, return 0 or -1 if the client has to go
+static int publish_send (const int fd, const char *line) {
+
+	const size_t len = strlen (line);
+
+	return send (fd, line, len, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t) len ? 0 : -1;
+}
+
+
+
+static void *publish_thread (void *arg) {
+
+	publish_t *pub = arg;
+	unsigned int i;
+	int fd, slot;
+
+	while (1) {
+		if ((fd = accept (pub->sock, NULL, NULL)) < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			if (pub->debug) printf ("can't accept clients for the data: %s\n", strerror (errno));
+			break;
+		}
+
+		pthread_mutex_lock (&pub->lock);
+
+		for (slot = 0 ; slot < PUBLISH_CLIENTS && pub->client[slot] >= 0 ; slot++);
+		if (slot == PUBLISH_CLIENTS) {
+			if (pub->debug) printf ("too many clients for the data\n");
+			close (fd);
+			pthread_mutex_unlock (&pub->lock);
+			continue;
+		}
+
+// catch up from the oldest block kept
+		i = pub->count > PUBLISH_BACKLOG ? pub->count - PUBLISH_BACKLOG : 0;
+		for ( ; i < pub->count && publish_send (fd, pub->backlog[i % PUBLISH_BACKLOG]) == 0 ; i++);
+		if (i < pub->count) close (fd);
+		else pub->client[slot] = fd;
+
+		pthread_mutex_unlock (&pub->lock);
+	}
+
+	return NULL;
+}
+
+
+
+// listen on 'path', return 0 or -1 on error
+int publish_open (publish_t *pub, const char *path, const int debug) {
+
+	struct sockaddr_un addr;
+	int i;
+
+	memset (pub, 0, sizeof (*pub));
+	for (i = 0 ; i < PUBLISH_CLIENTS ; i++) pub->client[i] = -1;
+	pub->debug = debug;
+	pthread_mutex_init (&pub->lock, NULL);
+
+	if (strlen (path) >= sizeof (addr.sun_path)) return -1;
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, path);
+
+	if ((pub->sock = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) return -1;
+	unlink (path);
+	if (bind (pub->sock, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen (pub->sock, PUBLISH_CLIENTS) < 0) {
+		close (pub->sock);
+		return -1;
+	}
+
+	if (pthread_create (&pub->thread, NULL, publish_thread, pub)) {
+		close (pub->sock);
+		return -1;
+	}
+	return 0;
+}
+
+
+
+// keep the block and hand it to every client
+void publish_block (publish_t *pub, const char *line) {
+
+	int i;
+
+	pthread_mutex_lock (&pub->lock);
+
+	strncpy (pub->backlog[pub->count % PUBLISH_BACKLOG], line, PUBLISH_LINE - 1);
+	pub->count++;
+
+	for (i = 0 ; i < PUBLISH_CLIENTS ; i++) {
+		if (pub->client[i] < 0 || publish_send (pub->client[i], line) == 0) continue;
+		if (pub->debug) printf ("client %d of the data is gone or too slow, dropped\n", i);
+		close (pub->client[i]);
+		pub->client[i] = -1;
+	}
+
+	pthread_mutex_unlock (&pub->lock);
+}
@@ -0,0 +1,33 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * publisher of the third-party data (bit 1 to 14) on a UNIX socket.
+ *
+ * Every client that connects gets the blocks of the backlog first,
+ * then every new block as a line of text, the same line as on the FIFO.
+ * A client that can't take a block at once is dropped, it can connect
+ * again and catch up from the backlog.
+ */
+
+#ifndef DCF77_PUBLISH_H
+#define DCF77_PUBLISH_H
+
+#include <pthread.h>
+
+#define PUBLISH_CLIENTS 16
+#define PUBLISH_BACKLOG 20		// blocks of 3 minutes, one hour
+#define PUBLISH_LINE    128
+
+typedef struct {
+	int sock;
+	int client[PUBLISH_CLIENTS];	// -1 if free
+	char backlog[PUBLISH_BACKLOG][PUBLISH_LINE];
+	unsigned int count;				// blocks published so far
+	int debug;
+	pthread_mutex_t lock;
+	pthread_t thread;
+} publish_t;
+
+int publish_open (publish_t *pub, const char *path, const int debug);
+void publish_block (publish_t *pub, const char *line);
+
+#endif
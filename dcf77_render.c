@@ -0,0 +1,151 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * render the binary event log of 'dcf77_clock -e' as the text of '-D'.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "dcf77_event.h"
+
+#define RENDER_BATCH 256
+
+
+
+static void render_event (const dcf77_event *ev, const int edges) {
+
+	if (ev->type == EVENT_EDGE && edges == 0) return;
+
+	printf ("%10lld.%09lld ", (long long) (ev->real / 1000000000LL), (long long) (ev->real % 1000000000LL));
+	if (ev->source == EVENT_OUTPUT) printf ("out  : ");
+	else printf ("rcv %d: ", ev->source);
+
+	switch (ev->type) {
+
+		case EVENT_EDGE:
+			printf ("edge pin %d level %d\n", ev->b, ev->a);
+			break;
+
+		case EVENT_SYNC:
+			if (ev->a < 0) printf ("found falling edge\n");
+			else if (ev->a > 0) printf ("found rising edge\n");
+			else printf ("syncing...\n");
+			break;
+
+		case EVENT_MARK:
+			printf ("= -> Dev: %+12.6lf msec / Signal: %d%%", 0.000001 * ev->value, ev->b);
+			if (ev->a >= 0) printf (" / Sec: %02d\n", ev->a);
+			else printf (" / Sec: --\n");
+			break;
+
+		case EVENT_PULSE:
+			printf ("%d -> Dev: %+12.6lf msec / Signal: %d%%\n", ev->a, 0.000001 * ev->value, ev->b);
+			break;
+
+		case EVENT_NOISE:
+			printf ("---- Dev: %+12.6lf msec\n", 0.000001 * ev->value);
+			break;
+
+		case EVENT_RESYNC:
+			printf ("search for new minute start...\n");
+			break;
+
+		case EVENT_MINUTE:
+			printf ("Minute: %10lld %2d", (long long) ev->value, ev->a);
+			if (ev->b >= 0) printf (" / Bit errors: %d", ev->b);
+			printf ("\n");
+			break;
+
+		case EVENT_SAMPLE:
+			printf ("Sample: second %02d offset %+12.6lf msec%s\n", ev->a, 0.000001 * ev->value, ev->b ? " / Leap-Second" : "");
+			break;
+
+		case EVENT_LOST:
+			printf ("%lld records lost\n", (long long) ev->value);
+			break;
+
+		default:
+			printf ("unknown record %d\n", ev->type);
+			break;
+	}
+}
+
+
+
+int main (int argc, char *argv[])
+{
+
+	unsigned char buf[RENDER_BATCH * sizeof (dcf77_event)];
+	const dcf77_event_header *header = (const dcf77_event_header *) buf;
+	dcf77_event ev;
+	size_t fill = 0, pos;
+	ssize_t ret;
+	int fd = STDIN_FILENO, edges = 0, source = -1, first = 1, i;
+
+	while ((i = getopt (argc, argv, "har:")) != -1) {
+		switch (i) {
+
+			case 'h':
+				fprintf (stderr, "Usage: %s [-h] [-a] [-r <num>] [<log>]\n", argv[0]);
+				fprintf (stderr, "    -h          this helptext\n");
+				fprintf (stderr, "    -a          show every edge\n");
+				fprintf (stderr, "    -r <num>    only the records of receiver <num>, 255 for the output\n");
+				fprintf (stderr, "    <log>       event log of 'dcf77_clock -e' (default: stdin)\n");
+				return EXIT_FAILURE;
+
+			case 'a':
+				edges = 1;
+				break;
+
+			case 'r':
+				source = atoi (optarg);
+				break;
+
+			default:
+				fprintf(stderr, "See '%s -h' for more information.\n", argv[0]);
+				return EXIT_FAILURE;
+
+		}
+	}
+
+	if (optind < argc && (fd = open (argv[optind], O_RDONLY)) < 0) {
+		fprintf (stderr, "Can't open event log '%s'! exit.\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	while (1) {
+		ret = read (fd, buf + fill, sizeof (buf) - fill);
+		if (ret < 0 && errno == EINTR) continue;
+		if (ret <= 0) break;
+		fill += ret;
+
+// the header is checked once, a socket may deliver it in pieces
+		if (first) {
+			if (fill < sizeof (*header)) continue;
+			if (memcmp (header->magic, DCF77_EVENT_MAGIC, sizeof (header->magic)) || header->version != DCF77_EVENT_VERSION || header->record_size != sizeof (dcf77_event)) {
+				fprintf (stderr, "Wrong format of the event log! exit.\n");
+				return EXIT_FAILURE;
+			}
+			fill -= sizeof (*header);
+			memmove (buf, buf + sizeof (*header), fill);
+			first = 0;
+		}
+
+		for (pos = 0 ; pos + sizeof (ev) <= fill ; pos += sizeof (ev)) {
+			memcpy (&ev, buf + pos, sizeof (ev));
+			if (source < 0 || ev.source == source) render_event (&ev, edges);
+		}
+		fill -= pos;
+		memmove (buf, buf + pos, fill);
+	}
+
+	if (fd != STDIN_FILENO) close (fd);
+	return EXIT_SUCCESS;
+}
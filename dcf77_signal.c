@@ -0,0 +1,210 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * synthetic DCF77 signal, the edge stream a receiver module would deliver.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "dcf77_signal.h"
+#include "dcf77_civil.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+
+static void put_bcd (int8_t *data, int num, int count) {
+
+	int i, bits = (num % 10) | ((num / 10) << 4);
+
+	for (i = 0 ; i < count ; i++) data[i] = (bits >> i) & 1;
+}
+
+
+
+static int8_t get_parity (const int8_t *data, int count) {
+
+	int i, parity = 0;
+
+	for (i = 0 ; i < count ; i++) parity ^= data[i];
+	return parity;
+}
+
+
+
+// encode the bits sent in 'minute' (UTC), they tell the local time of the next minute
+void signal_frame (int8_t *data, time_t minute, time_t leap, uint16_t weather) {
+
+	time_t next = minute + 60;
+	int64_t days;
+	int i, cest, year, mon, day;
+
+	cest = civil_cest (next);
+	days = (next + (cest ? 7200 : 3600)) / 86400;
+	civil_from_days (days, &year, &mon, &day);
+
+	for (i = 0 ; i < 61 ; i++) data[i] = -1;
+
+	data[0] = 0;
+	for (i = 0 ; i < 14 ; i++) data[i + 1] = (weather >> i) & 1;
+	data[15] = 0;
+	data[16] = civil_cest (minute) != civil_cest (minute + 3600);
+	data[17] = cest;
+	data[18] = !cest;
+	data[19] = leap && minute < leap && minute + 3600 >= leap;
+	data[20] = 1;
+
+	put_bcd (&data[21], ((next + (cest ? 7200 : 3600)) / 60) % 60, 7);
+	data[28] = get_parity (&data[21], 7);
+	put_bcd (&data[29], ((next + (cest ? 7200 : 3600)) / 3600) % 24, 6);
+	data[35] = get_parity (&data[29], 6);
+	put_bcd (&data[36], day, 6);
+	put_bcd (&data[42], (days + 3) % 7 + 1, 3);
+	put_bcd (&data[45], mon, 5);
+	put_bcd (&data[50], year % 100, 8);
+	data[58] = get_parity (&data[36], 22);
+
+// the leap second is sent as an extra zero, the minute marker moves to second 60
+	if (leap && minute + 60 == leap) data[59] = 0;
+}
+
+
+
+// xorshift64* random numbers
+static uint64_t random_next (signal_t *sig) {
+	sig->rng ^= sig->rng >> 12;
+	sig->rng ^= sig->rng << 25;
+	sig->rng ^= sig->rng >> 27;
+	return sig->rng * 2685821657736338717ULL;
+}
+
+static double random_uniform (signal_t *sig) {
+	return (random_next (sig) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double random_gauss (signal_t *sig) {
+
+	double u = random_uniform (sig);
+
+	if (u < 1e-300) u = 1e-300;
+	return sqrt (-2.0 * log (u)) * cos (2.0 * M_PI * random_uniform (sig));
+}
+
+
+
+static void start_minute (signal_t *sig) {
+	signal_frame (sig->data, sig->minute, sig->cfg.leap, sig->cfg.weather);
+	sig->seconds = (sig->cfg.leap && sig->minute + 60 == sig->cfg.leap) ? 61 : 60;
+	sig->second = 0;
+}
+
+
+
+void signal_init (signal_t *sig, const signal_config_t *cfg) {
+
+	memset (sig, 0, sizeof (*sig));
+	sig->cfg = *cfg;
+	sig->rng = cfg->seed ? cfg->seed : 0x9e3779b97f4a7c15ULL;
+	sig->minute = cfg->start - cfg->start % 60;
+	start_minute (sig);
+}
+
+
+
+static void add_edge (signal_t *sig, double offset, int8_t level) {
+
+	edge_t *edge = &sig->edge[sig->count++];
+	double real = (double) sig->minute + sig->second;
+	double elapsed = (double) sig->elapsed + offset;
+
+	memset (edge, 0, sizeof (*edge));
+	edge->mono = sig->cfg.mono + (int64_t) (elapsed * (1.0 + sig->cfg.drift * 1e-6) * 1e9);
+	edge->real = (int64_t) ((real + offset) * 1e9);
+	edge->level = level;
+}
+
+
+
+// build all edges of the next second, sorted by time
+static void next_second (signal_t *sig) {
+
+	edge_t tmp;
+	size_t i, j, count;
+	double start, width, glitch;
+	int n;
+
+	sig->count = 0;
+	sig->pos = 0;
+
+// no pulse in the last second of a minute
+	if (sig->data[sig->second] >= 0) {
+		start = random_gauss (sig) * sig->cfg.jitter * 1e-9;
+		width = (sig->data[sig->second] ? 0.2 : 0.1) + random_gauss (sig) * sig->cfg.jitter * 1e-9;
+		add_edge (sig, start, 1);
+		add_edge (sig, start + width, 0);
+	}
+
+	glitch = sig->cfg.glitch;
+	for (n = 0 ; n < SIGNAL_GLITCH_MAX && random_uniform (sig) < glitch ; n++, glitch -= 1.0) {
+		start = 0.01 + random_uniform (sig) * 0.9;
+		width = 0.002 + random_uniform (sig) * 0.05;
+		add_edge (sig, start, 1);
+		add_edge (sig, start + width, 0);
+	}
+
+	for (i = 1 ; i < sig->count ; i++) {
+		tmp = sig->edge[i];
+		for (j = i ; j > 0 && sig->edge[j - 1].mono > tmp.mono ; j--) sig->edge[j] = sig->edge[j - 1];
+		sig->edge[j] = tmp;
+	}
+
+// overlapping pulses leave the receiver output at the level of the last edge
+	for (i = 0, n = 0 ; i < sig->count ; i++) {
+		n += sig->edge[i].level ? 1 : -1;
+		sig->edge[i].level = n > 0;
+	}
+
+// lose edges, then map them to the output pins
+	for (i = 0, count = 0 ; i < sig->count ; i++) {
+		if (random_uniform (sig) < sig->cfg.dropout) continue;
+		tmp = sig->edge[i];
+		if (sig->cfg.pin[1] >= 0) {
+			tmp.pin = tmp.level ? sig->cfg.pin[0] : sig->cfg.pin[1];
+			tmp.level = 1;
+		}
+		else {
+			tmp.pin = sig->cfg.pin[0];
+		}
+		sig->edge[count++] = tmp;
+	}
+	sig->count = count;
+
+	sig->elapsed++;
+	if (++sig->second >= sig->seconds) {
+		sig->minute += 60;
+		start_minute (sig);
+	}
+}
+
+
+
+// fill up to 'max' edges, return the number of edges or 0 at the end
+size_t signal_edges (signal_t *sig, edge_t *edge, size_t max) {
+
+	size_t count = 0;
+
+	while (count < max) {
+		if (sig->pos >= sig->count) {
+			if (sig->minute + sig->second >= sig->cfg.end) break;
+			next_second (sig);
+			continue;
+		}
+		edge[count++] = sig->edge[sig->pos++];
+	}
+
+	return count;
+}
@@ -0,0 +1,49 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * synthetic DCF77 signal, the edge stream a receiver module would deliver.
+ */
+
+#ifndef DCF77_SIGNAL_H
+#define DCF77_SIGNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "dcf77_trace.h"
+
+// at most this many glitches are added to one second
+#define SIGNAL_GLITCH_MAX 16
+
+typedef struct {
+	time_t   start;		// first minute to send (UTC, rounded down to the minute)
+	time_t   end;		// stop before this time (UTC)
+	time_t   leap;		// insert a leap second right before this minute (UTC), 0 for none
+	long     jitter;	// standard deviation of every edge in ns
+	double   dropout;	// probability that an edge gets lost
+	double   glitch;	// spurious pulses per second
+	double   drift;		// frequency error of the receiver clock in ppm
+	int64_t  mono;		// CLOCK_MONOTONIC_RAW of the receiver at 'start' in ns
+	int      pin[2];	// pin of the output, second pin for the inverted output or -1
+	uint16_t weather;	// bits 1 to 14 (third-party data), sent in every minute
+	uint64_t seed;		// random seed for jitter, dropouts and glitches
+} signal_config_t;
+
+typedef struct {
+	signal_config_t cfg;
+	uint64_t rng;
+	time_t   minute;	// minute (UTC) that is sent right now
+	int      second;	// next second to send in this minute
+	int      seconds;	// 60 or 61 in a minute with leap second
+	int64_t  elapsed;	// seconds since start, including leap seconds
+	int8_t   data[61];	// bits of the current minute, -1 for no pulse
+	edge_t   edge[2 + 2 * SIGNAL_GLITCH_MAX];
+	size_t   count;
+	size_t   pos;
+} signal_t;
+
+void signal_init (signal_t *sig, const signal_config_t *cfg);
+size_t signal_edges (signal_t *sig, edge_t *edge, size_t max);
+void signal_frame (int8_t *data, time_t minute, time_t leap, uint16_t weather);
+
+#endif
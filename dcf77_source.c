@@ -0,0 +1,114 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * table of the edge sources compiled in.
+ */
+
+#define _GNU_SOURCE		// pthread_setaffinity_np
+
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "dcf77_source.h"
+
+
+
+static const source_ops * const source_table[] = {
+#ifdef HAVE_WIRINGPI
+	&source_wiringpi,
+#endif
+#ifdef HAVE_GPIOD
+	&source_gpiod,
+#endif
+	&source_trace,
+	&source_stdin,
+	&source_unix,
+	&source_pcm,
+	NULL
+};
+
+
+
+// 'spec' is 'name' or 'name:arg', return the source and the argument or NULL if unknown
+const source_ops *source_find (const char *spec, const char **arg) {
+
+	const char *colon = strchr (spec, ':');
+	size_t len = colon ? (size_t) (colon - spec) : strlen (spec);
+	int i;
+
+	for (i = 0 ; source_table[i] ; i++) {
+		if (strlen (source_table[i]->name) == len && strncmp (source_table[i]->name, spec, len) == 0) {
+			*arg = colon ? colon + 1 : NULL;
+			return source_table[i];
+		}
+	}
+	return NULL;
+}
+
+
+
+// the first GPIO source, NULL if none is compiled in
+const source_ops *source_default (void) {
+	return source_table[0]->pins ? source_table[0] : NULL;
+}
+
+
+
+void source_usage (void) {
+
+	int i;
+
+	for (i = 0 ; source_table[i] ; i++) fprintf (stderr, "                %-18s %s\n", source_table[i]->syntax, source_table[i]->help);
+	fprintf (stderr, "                (default: %s)\n", source_default () ? source_default ()->name : "none");
+}
+
+
+
+// the pin index of an edge that does not come from the GPIO, 1 only for the inverted pin
+int source_pin (const edge_source *src, const edge_t *edge) {
+	return src->pin[1] >= 0 && edge->pin == src->pin[1];
+}
+
+
+
+// the calling thread of a source to SCHED_FIFO and its CPU, as given with '-R'
+// return 0 or -1 if not allowed, the thread then keeps running as it is
+int source_realtime (const edge_source *src) {
+
+	struct sched_param param;
+	cpu_set_t cpus;
+	int ret = 0;
+
+	if (src->rt_prio > 0) {
+		memset (&param, 0, sizeof (param));
+		param.sched_priority = src->rt_prio;
+		if (pthread_setschedparam (pthread_self (), SCHED_FIFO, &param) != 0) ret = -1;
+	}
+
+	if (src->cpu >= 0) {
+		CPU_ZERO (&cpus);
+		CPU_SET (src->cpu, &cpus);
+		if (pthread_setaffinity_np (pthread_self (), sizeof (cpus), &cpus) != 0) ret = -1;
+	}
+
+	if (ret < 0 && src->debug) printf ("receiver %d: can't run the capture with priority %d on CPU %d\n", src->index, src->rt_prio, src->cpu);
+	return ret;
+}
+
+
+
+// lock the memory of the process before the threads are started, so the capture never waits for a page
+// every thread gets a smaller stack, all of it is locked
+int source_lock (void) {
+
+	pthread_attr_t attr;
+
+	if (pthread_attr_init (&attr) == 0) {
+		pthread_attr_setstacksize (&attr, SOURCE_STACK);
+		pthread_setattr_default_np (&attr);
+		pthread_attr_destroy (&attr);
+	}
+	return mlockall (MCL_CURRENT | MCL_FUTURE);
+}
@@ -0,0 +1,83 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * sources of edges, the backends that feed the decoders.
+ *
+ * Every receiver gets its own source. A source pushes the edges of pin
+ * 'idx' (0 or 1 with the inverted output on the second pin) to the sink
+ * of the receiver, only one thread per 'idx' may push.
+ * Sources that are not bound to real time (stdin, socket) set 'wait'
+ * and push the rest again, when the decoder is behind.
+ * The backends are chosen at build time (HAVE_WIRINGPI, HAVE_GPIOD)
+ * and at run time by name.
+ * The threads of a source are the capture stage: they only take the
+ * timestamps and push, every thread calls the 'setup' hook first
+ * (source_realtime() in the daemon, the backends don't depend on it).
+ * A source that ends (a file, stdin) calls the 'done' hook after its last edge.
+ */
+
+#ifndef DCF77_SOURCE_H
+#define DCF77_SOURCE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "dcf77_trace.h"
+
+// wiringPi is the default backend, build with -DNO_WIRINGPI where it is not available
+#ifndef NO_WIRINGPI
+#define HAVE_WIRINGPI
+#endif
+
+#define SOURCE_STACK (512 * 1024)	// stack of every thread with locked memory
+
+// return the number of edges taken, the others are lost unless the source waits
+typedef size_t (edge_sink) (void *arg, const int idx, const edge_t *edge, const size_t count);
+
+typedef struct edge_source edge_source;
+
+typedef struct {
+	const char *name;
+	const char *syntax;			// for the usage, e.g. "gpiod[:<chip>]"
+	const char *help;
+	int pins;					// the source reads the pins given with '-g'
+	int (*start) (edge_source *src);	// start pushing edges, return 0 or -1 on error
+} source_ops;
+
+struct edge_source {
+	const source_ops *ops;
+	const char *arg;			// chip, file or socket after the ':', NULL if none
+	int pin[2];					// pin[1] < 0 without inverted output
+	unsigned long debounce;		// usec, if the backend supports it
+	int index;					// of the receiver
+	int debug;
+	int wait;					// the source can wait for room in the queue, instead of losing edges
+	int rt_prio;				// SCHED_FIFO priority of the threads, 0 for the default scheduling
+	int cpu;					// CPU the threads are pinned to, -1 for any
+	int (*setup) (const edge_source *src);	// called first by every thread of the source, NULL if none
+	void (*done) (const edge_source *src);	// called when a source that is not live has no more edges, NULL if none
+	int precision;				// set by start: best precision of the timestamps, power of two like ntpd, 0 if not limited
+	edge_sink *sink;
+	void *sink_arg;
+	pthread_t thread;
+	void *priv;					// state of the backend
+};
+
+#ifdef HAVE_WIRINGPI
+extern const source_ops source_wiringpi;
+#endif
+#ifdef HAVE_GPIOD
+extern const source_ops source_gpiod;
+#endif
+extern const source_ops source_trace;
+extern const source_ops source_stdin;
+extern const source_ops source_unix;
+extern const source_ops source_pcm;
+
+const source_ops *source_find (const char *spec, const char **arg);
+const source_ops *source_default (void);
+void source_usage (void);
+int source_pin (const edge_source *src, const edge_t *edge);
+int source_realtime (const edge_source *src);
+int source_lock (void);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * map the state file.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dcf77_state.h"
+
+
+
+// map the state file, a new or foreign file starts empty
+// return the state or NULL on error
+dcf77_state *state_map (const char *name) {
+
+	dcf77_state *state;
+	struct stat st;
+	int fd;
+
+	if ((fd = open (name, O_RDWR | O_CREAT, 0644)) < 0) return NULL;
+	if (fstat (fd, &st) < 0 || (st.st_size != sizeof (*state) && ftruncate (fd, sizeof (*state)) < 0)) {
+		close (fd);
+		return NULL;
+	}
+
+	state = mmap (NULL, sizeof (*state), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close (fd);
+	if (state == MAP_FAILED) return NULL;
+
+	if (memcmp (state->magic, DCF77_STATE_MAGIC, sizeof (state->magic)) || state->version != DCF77_STATE_VERSION || state->size != sizeof (*state)) {
+		memset (state, 0, sizeof (*state));
+		memcpy (state->magic, DCF77_STATE_MAGIC, sizeof (state->magic));
+		state->version = DCF77_STATE_VERSION;
+		state->size = sizeof (*state);
+	}
+
+	return state;
+}
@@ -0,0 +1,30 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * state file, what the decoders have learned is kept over a restart.
+ *
+ * The file is mapped into memory and updated after every decoded minute,
+ * so it is current even if the daemon is killed.
+ * All values are in host byte order.
+ */
+
+#ifndef DCF77_STATE_H
+#define DCF77_STATE_H
+
+#include <stdint.h>
+
+#include "dcf77_decoder.h"
+
+#define DCF77_STATE_MAGIC   "DCF77STA"
+#define DCF77_STATE_VERSION 1
+#define STATE_SLOTS         RECEIVER_MAX	// one per receiver
+
+typedef struct {
+	char     magic[8];		// DCF77_STATE_MAGIC without '\0'
+	uint32_t version;		// DCF77_STATE_VERSION
+	uint32_t size;			// sizeof (dcf77_state)
+	dcf77_prior prior[STATE_SLOTS];
+} dcf77_state;
+
+dcf77_state *state_map (const char *name);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * streaming statistics of pulse widths and second marks.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "dcf77_stats.h"
+
+static const char *stats_name[STATS_KINDS] = { "100ms", "200ms", "second" };
+
+
+
+void stats_init (dcf77_stats *stats, const long tolerance) {
+	memset (stats, 0, sizeof (*stats));
+	stats->tolerance = tolerance;
+}
+
+
+
+// exponentially weighted mean and variance, exact as long as less then STATS_WINDOW values are seen
+void stats_add (stats_t *st, const long value) {
+
+	double diff, weight;
+	int bin;
+
+	st->count++;
+	weight = st->count < STATS_WINDOW ? 1.0 / st->count : 1.0 / STATS_WINDOW;
+
+	diff = value - st->mean;
+	st->mean += weight * diff;
+	st->var = (1.0 - weight) * (st->var + weight * diff * diff);
+
+	if (st->count == 1 || value < st->min) st->min = value;
+	if (st->count == 1 || value > st->max) st->max = value;
+
+	if (value < -STATS_RANGE) bin = 0;
+	else bin = (value + STATS_RANGE) / (2 * STATS_RANGE / STATS_BINS);
+	if (bin >= STATS_BINS) bin = STATS_BINS - 1;
+	st->bin[bin]++;
+}
+
+
+
+// quality in percent by the standard deviation, 0 means the deviation is as big as the tolerance
+int stats_quality (const stats_t *st, const long tolerance) {
+
+	double quality;
+
+	if (st->count == 0 || tolerance <= 0) return 0;
+
+	quality = 100.0 * (tolerance - sqrt (st->var)) / tolerance;
+	if (quality < 0.0) quality = 0.0;
+	return quality;
+}
+
+
+
+void output_stats (const dcf77_stats *stats) {
+
+	const stats_t *st;
+	int i, j;
+
+	for (i = 0 ; i < STATS_KINDS ; i++) {
+		st = &stats->stat[i];
+		printf ("%-6s: %8llu  Mean: %+9.3lf  Dev: %7.3lf  Min: %+8.3lf  Max: %+8.3lf msec  Quality: %3d%%\n", stats_name[i],
+			(unsigned long long) st->count, 0.000001 * st->mean, 0.000001 * sqrt (st->var),
+			0.000001 * st->min, 0.000001 * st->max, stats_quality (st, stats->tolerance));
+		printf ("        ");
+		for (j = 0 ; j < STATS_BINS ; j++) printf (" %u", st->bin[j]);
+		printf ("\n");
+	}
+	printf ("Edges : %8llu  Noise: %llu  Minutes: %llu  Resyncs: %llu  Parity errors: %llu %llu %llu\n",
+		(unsigned long long) stats->edges, (unsigned long long) stats->noise, (unsigned long long) stats->minutes, (unsigned long long) stats->resyncs,
+		(unsigned long long) stats->parity[0], (unsigned long long) stats->parity[1], (unsigned long long) stats->parity[2]);
+	printf ("Bits  : %8llu  Errors: %llu (%.3lf%%)\n", (unsigned long long) stats->bit_cnt, (unsigned long long) stats->bit_err,
+		stats->bit_cnt ? 100.0 * stats->bit_err / stats->bit_cnt : 0.0);
+}
@@ -0,0 +1,49 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * streaming statistics of pulse widths and second marks.
+ */
+
+#ifndef DCF77_STATS_H
+#define DCF77_STATS_H
+
+#include <stdint.h>
+
+#define STATS_BINS   16
+#define STATS_RANGE  40000000L	// the histogram covers -40 to +40 msec, outliers go to the outer bins
+#define STATS_WINDOW 64			// mean and variance follow the last ~64 values
+
+// deviation of one kind of event from its nominal time in nsec
+typedef struct {
+	uint64_t count;
+	double mean;
+	double var;
+	long min;
+	long max;
+	uint32_t bin[STATS_BINS];
+} stats_t;
+
+#define STATS_SHORT  0	// 100 msec pulses
+#define STATS_LONG   1	// 200 msec pulses
+#define STATS_SECOND 2	// spacing of the second marks
+#define STATS_KINDS  3
+
+#define STATS_FIELDS 3	// minute, hour and date, like the fields of the decoder
+
+typedef struct {
+	long tolerance;
+	stats_t stat[STATS_KINDS];
+	uint64_t bit_cnt;	// bits compared with the frame expected
+	uint64_t bit_err;	// bits that differ
+	uint64_t edges;		// all edges fed to the decoder
+	uint64_t noise;		// edges that are neither second mark nor pulse
+	uint64_t minutes;	// minute marks
+	uint64_t resyncs;	// minute start lost and searched again
+	uint64_t parity[STATS_FIELDS];	// minutes with a failed parity
+} dcf77_stats;
+
+void stats_init (dcf77_stats *stats, const long tolerance);
+void stats_add (stats_t *st, const long value);
+int stats_quality (const stats_t *st, const long tolerance);
+void output_stats (const dcf77_stats *stats);
+
+#endif
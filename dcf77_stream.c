@@ -0,0 +1,230 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * edges from a trace in real time, from stdin or from a UNIX socket.
+ *
+ * stdin and the socket take the trace format, the header is optional,
+ * so another process can feed edges with its own timestamps
+ * (CLOCK_MONOTONIC_RAW and CLOCK_REALTIME in nanoseconds, see 'dcf77_trace.h').
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "dcf77_source.h"
+
+#define STREAM_BATCH 64
+
+typedef struct {
+	const edge_t *edge;
+	size_t count;
+} trace_priv;
+
+
+
+static int64_t clock_ns (const clockid_t clock) {
+
+	struct timespec ts;
+
+	clock_gettime (clock, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+
+// hand over the runs of edges of the same pin, wait while the queue is full
+static void stream_push (edge_source *src, const edge_t *edge, const size_t count) {
+
+	struct timespec ts = { 0, 1000000L };
+	size_t i, j;
+
+	for (i = 0 ; i < count ; ) {
+		for (j = i + 1 ; j < count && source_pin (src, &edge[j]) == source_pin (src, &edge[i]) ; j++);
+		i += src->sink (src->sink_arg, source_pin (src, &edge[i]), &edge[i], j - i);
+		if (i < j) nanosleep (&ts, NULL);
+	}
+}
+
+
+
+// read edges until end of file, return 0 or -1 on error
+static int stream_copy (edge_source *src, const int fd) {
+
+	unsigned char buf[STREAM_BATCH * sizeof (edge_t)];
+	edge_t edge[STREAM_BATCH];
+	const dcf77_trace_header *header = (const dcf77_trace_header *) buf;
+	size_t fill = 0, count;
+	ssize_t ret;
+	int first = 1;
+
+	while (1) {
+		ret = read (fd, buf + fill, sizeof (buf) - fill);
+		if (ret < 0 && errno == EINTR) continue;
+		if (ret <= 0) return ret;
+		fill += ret;
+
+// skip the header, if there is one
+		if (first) {
+			if (fill < sizeof (header->magic)) continue;
+			if (memcmp (header->magic, DCF77_TRACE_MAGIC, sizeof (header->magic)) == 0) {
+				if (fill < sizeof (*header)) continue;
+				if (header->version != DCF77_TRACE_VERSION || header->record_size != sizeof (edge_t)) {
+					if (src->debug) printf ("receiver %d: wrong trace format\n", src->index);
+					return -1;
+				}
+				fill -= sizeof (*header);
+				memmove (buf, buf + sizeof (*header), fill);
+			}
+			first = 0;
+		}
+
+		count = fill / sizeof (edge_t);
+		memcpy (edge, buf, count * sizeof (edge_t));
+		fill -= count * sizeof (edge_t);
+		memmove (buf, buf + count * sizeof (edge_t), fill);
+
+		stream_push (src, edge, count);
+	}
+}
+
+
+
+// replay a trace at the speed it was recorded, the monotonic time is moved to now
+static void *trace_thread (void *arg) {
+
+	edge_source *src = arg;
+	const trace_priv *trace = src->priv;
+	struct timespec ts;
+	int64_t base_raw, base_mono, first, wake;
+	edge_t edge;
+	size_t i;
+
+	if (src->setup) src->setup (src);
+	base_raw = clock_ns (CLOCK_MONOTONIC_RAW);
+	base_mono = clock_ns (CLOCK_MONOTONIC);
+	first = trace->edge[0].mono;
+
+	for (i = 0 ; i < trace->count ; i++) {
+		wake = base_mono + trace->edge[i].mono - first;
+		ts.tv_sec = wake / 1000000000LL;
+		ts.tv_nsec = wake % 1000000000LL;
+		while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+
+		edge = trace->edge[i];
+		edge.mono = base_raw + trace->edge[i].mono - first;
+		stream_push (src, &edge, 1);
+	}
+
+	if (src->debug) printf ("receiver %d: end of trace '%s'\n", src->index, src->arg);
+	if (src->done) src->done (src);
+	return NULL;
+}
+
+
+
+static void *stdin_thread (void *arg) {
+
+	edge_source *src = arg;
+
+	if (src->setup) src->setup (src);
+	if (stream_copy (src, STDIN_FILENO) < 0 && src->debug) printf ("receiver %d: can't read stdin: %s\n", src->index, strerror (errno));
+	else if (src->debug) printf ("receiver %d: end of stdin\n", src->index);
+	if (src->done) src->done (src);
+	return NULL;
+}
+
+
+
+// one feeding process at a time
+static void *unix_thread (void *arg) {
+
+	edge_source *src = arg;
+	int sock = (intptr_t) src->priv, fd;
+
+	if (src->setup) src->setup (src);
+	while (1) {
+		if ((fd = accept (sock, NULL, NULL)) < 0) {
+			if (errno == EINTR) continue;
+			if (src->debug) printf ("receiver %d: can't accept on '%s': %s\n", src->index, src->arg, strerror (errno));
+			break;
+		}
+		if (src->debug) printf ("receiver %d: edges from '%s'\n", src->index, src->arg);
+		stream_copy (src, fd);
+		close (fd);
+	}
+
+	if (src->done) src->done (src);
+	return NULL;
+}
+
+
+
+static int trace_start (edge_source *src) {
+
+	trace_priv *trace;
+
+	if (src->arg == NULL || (trace = malloc (sizeof (*trace))) == NULL) return -1;
+	if ((trace->edge = trace_map (src->arg, &trace->count)) == NULL || trace->count == 0) {
+		free (trace);
+		return -1;
+	}
+
+	src->priv = trace;
+	return pthread_create (&src->thread, NULL, trace_thread, src) ? -1 : 0;
+}
+
+
+
+static int stdin_start (edge_source *src) {
+	src->wait = 1;
+	return pthread_create (&src->thread, NULL, stdin_thread, src) ? -1 : 0;
+}
+
+
+
+static int unix_start (edge_source *src) {
+
+	struct sockaddr_un addr;
+	int sock;
+
+	if (src->arg == NULL || strlen (src->arg) >= sizeof (addr.sun_path)) return -1;
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, src->arg);
+
+	if ((sock = socket (AF_UNIX, SOCK_STREAM, 0)) < 0) return -1;
+	unlink (src->arg);
+	if (bind (sock, (struct sockaddr *) &addr, sizeof (addr)) < 0 || listen (sock, 1) < 0) {
+		close (sock);
+		return -1;
+	}
+
+	src->priv = (void *) (intptr_t) sock;
+	src->wait = 1;
+	return pthread_create (&src->thread, NULL, unix_thread, src) ? -1 : 0;
+}
+
+
+
+const source_ops source_trace = {
+	"trace", "trace:<file>", "replay a trace in real time", 0, trace_start
+};
+
+const source_ops source_stdin = {
+	"stdin", "stdin", "edges in the trace format from stdin", 0, stdin_start
+};
+
+const source_ops source_unix = {
+	"unix", "unix:<socket>", "edges in the trace format from a process connecting to a UNIX socket", 0, unix_start
+};
@@ -0,0 +1,113 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * read and write binary edge traces.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dcf77_trace.h"
+
+
+
+// open a trace file for appending, write the header if the file is new
+// an existing file must have the header of this format, a broken last record is cut off
+// return the filedescriptor or -1 on error
+int trace_open (const char *name) {
+
+	dcf77_trace_header header;
+	struct timespec now;
+	struct stat st;
+	off_t end;
+	int fd;
+
+// read and write, the header of an existing file is checked, the records are appended anyway
+	if ((fd = open (name, O_RDWR | O_CREAT | O_APPEND, 0644)) < 0) return -1;
+	if (fstat (fd, &st) < 0) {
+		close (fd);
+		return -1;
+	}
+
+	if (st.st_size == 0) {
+		clock_gettime (CLOCK_REALTIME, &now);
+		memset (&header, 0, sizeof (header));
+		memcpy (header.magic, DCF77_TRACE_MAGIC, sizeof (header.magic));
+		header.version = DCF77_TRACE_VERSION;
+		header.record_size = sizeof (edge_t);
+		header.created = now.tv_sec * 1000000000LL + now.tv_nsec;
+		if (write (fd, &header, sizeof (header)) != sizeof (header)) {
+			close (fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	if (lseek (fd, 0, SEEK_SET) < 0 || read (fd, &header, sizeof (header)) != sizeof (header) || memcmp (header.magic, DCF77_TRACE_MAGIC, sizeof (header.magic))
+		|| header.version != DCF77_TRACE_VERSION || header.record_size != sizeof (edge_t)) {
+		fprintf (stderr, "Trace '%s' is not a trace of this version, not appended to!\n", name);
+		close (fd);
+		return -1;
+	}
+
+	end = st.st_size - (st.st_size - sizeof (header)) % sizeof (edge_t);
+	if (end != st.st_size) {
+		fprintf (stderr, "Trace '%s' has a broken last record, cut off.\n", name);
+		if (ftruncate (fd, end) < 0) {
+			close (fd);
+			return -1;
+		}
+	}
+
+	return fd;
+}
+
+
+
+// append records, return 0 on success or -1 on error
+int trace_write (int fd, const edge_t *edge, size_t count) {
+	if (fd < 0 || count == 0) return 0;
+	if (write (fd, edge, count * sizeof (edge_t)) != (ssize_t) (count * sizeof (edge_t))) return -1;
+	return 0;
+}
+
+
+
+// map a trace file into memory
+// return the first record and the number of records in 'count', NULL on error
+const edge_t *trace_map (const char *name, size_t *count) {
+
+	const dcf77_trace_header *header;
+	struct stat st;
+	void *map;
+	int fd;
+
+	if ((fd = open (name, O_RDONLY)) < 0) return NULL;
+	if (fstat (fd, &st) < 0 || st.st_size < sizeof (*header)) {
+		close (fd);
+		return NULL;
+	}
+
+	map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (map == MAP_FAILED) return NULL;
+
+	header = map;
+	if (memcmp (header->magic, DCF77_TRACE_MAGIC, sizeof (header->magic)) || header->version != DCF77_TRACE_VERSION || header->record_size != sizeof (edge_t)) {
+		munmap (map, st.st_size);
+		return NULL;
+	}
+
+	posix_madvise (map, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+	*count = (st.st_size - sizeof (*header)) / sizeof (edge_t);
+	return (const edge_t *) (header + 1);
+}
@@ -0,0 +1,41 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * binary edge trace format, shared by the daemon and the tools.
+ *
+ * A trace is a header followed by fixed-size edge records, so it can be
+ * mapped into memory and read as an array.  Records are only appended,
+ * the number of records is derived from the file size.
+ * All values are in host byte order.
+ */
+
+#ifndef DCF77_TRACE_H
+#define DCF77_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DCF77_TRACE_MAGIC   "DCF77TRC"
+#define DCF77_TRACE_VERSION 1
+
+typedef struct {
+	char     magic[8];		// DCF77_TRACE_MAGIC without '\0'
+	uint32_t version;		// DCF77_TRACE_VERSION
+	uint32_t record_size;	// sizeof (edge_t)
+	int64_t  created;		// CLOCK_REALTIME in ns
+	uint8_t  reserved[40];
+} dcf77_trace_header;
+
+// one edge as seen by the ISR, times in nanoseconds
+typedef struct {
+	int64_t mono;	// CLOCK_MONOTONIC_RAW
+	int64_t real;	// CLOCK_REALTIME
+	int8_t  pin;
+	int8_t  level;
+	int8_t  reserved[6];
+} edge_t;
+
+int trace_open (const char *name);
+int trace_write (int fd, const edge_t *edge, size_t count);
+const edge_t *trace_map (const char *name, size_t *count);
+
+#endif
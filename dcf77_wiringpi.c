@@ -0,0 +1,88 @@
+/*
+ * DCF77 decoder for the RaspberryPi
+ * edges from the ISR of the wiringPi library.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <wiringPi.h>
+
+#include "dcf77_source.h"
+
+#define WIRINGPI_SLOTS 8	// pins with an ISR
+
+// the ISR runs in its own thread per pin, it is the only producer of its pin
+static edge_source *slot_src[WIRINGPI_SLOTS];
+static int slot_idx[WIRINGPI_SLOTS];
+static int slot_rt[WIRINGPI_SLOTS];		// the thread of the ISR is set up
+static int slot_cnt = 0;
+
+
+
+static void edge_push (const int slot) {
+
+	edge_source *src = slot_src[slot];
+	struct timespec mono, real;
+	edge_t edge;
+
+	clock_gettime (CLOCK_MONOTONIC_RAW, &mono);
+	clock_gettime (CLOCK_REALTIME, &real);
+
+// wiringPi creates the thread, it is set up on its first edge
+	if (slot_rt[slot] == 0) {
+		slot_rt[slot] = 1;
+		if (src->setup) src->setup (src);
+	}
+
+	memset (&edge, 0, sizeof (edge));
+	edge.mono = mono.tv_sec * 1000000000LL + mono.tv_nsec;
+	edge.real = real.tv_sec * 1000000000LL + real.tv_nsec;
+	edge.pin = src->pin[slot_idx[slot]];
+	edge.level = digitalRead (edge.pin);
+
+	src->sink (src->sink_arg, slot_idx[slot], &edge, 1);
+}
+
+// wiringPi calls the ISR without argument, so every pin needs its own function
+#define EDGE_SIG(s) static void edge_sig_##s (void) { edge_push (s); }
+EDGE_SIG(0) EDGE_SIG(1) EDGE_SIG(2) EDGE_SIG(3)
+EDGE_SIG(4) EDGE_SIG(5) EDGE_SIG(6) EDGE_SIG(7)
+
+static void (* const edge_sig[WIRINGPI_SLOTS]) (void) = {
+	edge_sig_0, edge_sig_1, edge_sig_2, edge_sig_3,
+	edge_sig_4, edge_sig_5, edge_sig_6, edge_sig_7
+};
+
+
+
+static int wiringpi_start (edge_source *src) {
+
+	int j;
+
+	if (slot_cnt == 0) wiringPiSetup();
+
+	for (j = 0 ; j < 2 ; j++) {
+		if (src->pin[j] < 0) continue;
+		if (slot_cnt >= WIRINGPI_SLOTS) return -1;
+
+		slot_src[slot_cnt] = src;
+		slot_idx[slot_cnt] = j;
+
+		pinMode(src->pin[j], INPUT);
+		pullUpDnControl(src->pin[j], PUD_UP);
+		wiringPiISR(src->pin[j], src->pin[1] >= 0 ? INT_EDGE_RISING : INT_EDGE_BOTH, edge_sig[slot_cnt]);
+		slot_cnt++;
+	}
+
+	return 0;
+}
+
+
+
+const source_ops source_wiringpi = {
+	"wiringpi", "wiringpi", "ISR of the wiringPi library, '-g' takes wiringPi pin numbers", 1, wiringpi_start
+};